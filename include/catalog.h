@@ -0,0 +1,57 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "priority.h"
+#include "schedule.h"
+
+/*
+ * What the course file says about one course. Never changed once the
+ * catalog holding it is published; a reload publishes a new catalog.
+ */
+typedef struct {
+    char* title;
+    int   maxCap;
+    uint64_t open_at[PRIORITY_GROUPS];  // when each priority group may register
+    weekmask_t * meets;  // meeting times, NULL if none were given
+    uint32_t conflicts;  // courses whose meeting times overlap this one
+    uint32_t prereqs;    // courses that must be completed first
+    uint32_t coreqs;     // courses that must be completed or enrolled in
+} course_info_t;
+
+/*
+ * One version of the course file. Courses keep their index across
+ * reloads, a reload may only append courses.
+ */
+typedef struct {
+    int count;
+    course_info_t courses[32];
+} catalog_t;
+
+/*
+ * Parse a course file into a new catalog, off to the side.
+ *
+ * @param file_name course file
+ * @param err set to the reason on failure
+ * @return the catalog, NULL if the file could not be read or is invalid
+ */
+catalog_t * load_catalog(const char * file_name, char * err, size_t err_len);
+
+/*
+ * Pin the published catalog. It stays valid until the matching
+ * catalog_exit even if a reload publishes a new one meanwhile. Pins
+ * nest, a thread that already holds one gets the same catalog back.
+ * Never blocks: readers only touch two shared counters.
+ */
+catalog_t * catalog_enter();
+void catalog_exit();
+
+/*
+ * Make next the published catalog and free the previous one once every
+ * thread that could still be reading it has unpinned. The caller must
+ * not hold a pin.
+ */
+void catalog_publish(catalog_t * next);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef CONTESTED_H
+#define CONTESTED_H
+
+#include <stdint.h>
+
+#define CONTESTED_DEFAULT_K 5
+
+/*
+ * Snapshot of the numbers a course is ranked by.
+ *
+ * waiting - length of the course waitlist.
+ * enrolled - number of students enrolled.
+ * maxCap - capacity of the course.
+ */
+typedef struct {
+    int waiting;
+    int enrolled;
+    int maxCap;
+} contested_key_t;
+
+/*
+ * Build the index over courses [0, course_cnt). Every course starts out
+ * with the state currently stored in courseArray.
+ */
+void contested_init(int course_cnt);
+
+/*
+ * Add courses [current count, course_cnt) to the index after a reload
+ * appended them to the catalog. Their rosters must already exist.
+ */
+void contested_grow(int course_cnt);
+
+/*
+ * Record a course's new enrollment and waitlist length. Takes no lock,
+ * the course is re-ranked by the next contested_top. Must be called with
+ * courseArray_mutexes[index] held so the snapshot matches the lists.
+ *
+ * @param index course index into courseArray
+ */
+void contested_update(int index);
+
+/*
+ * Fetch the k most contested courses, longest waitlist first and then
+ * highest fill ratio. Courses changed since the last call are re-ranked
+ * first, then only O(k) heap slots are visited, the catalog is never
+ * scanned.
+ *
+ * @param k number of courses wanted
+ * @param count course count of the caller's catalog, courses past it are skipped
+ * @param out course indices, at least k entries
+ * @param keys snapshot of each returned course, at least k entries (may be NULL)
+ * @return number of courses written to out
+ */
+int contested_top(int k, int count, int* out, contested_key_t* keys);
+
+#endif
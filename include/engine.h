@@ -0,0 +1,170 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vector.h"
+#include "userstore.h"
+#include "timerwheel.h"
+#include "priority.h"
+#include "schedule.h"
+#include "prereq.h"
+#include "catalog.h"
+#include "protocol.h"
+#include "overload.h"
+#include "ratelimit.h"
+#include "trace.h"
+
+#define BUFFER_SIZE 1024
+#define CACHE_LINE 64   // state written by different cores is kept on separate lines
+
+typedef struct {
+    int clientCnt;  
+    int threadCnt;  
+    int totalAdds;  
+    int totalDrops; 
+    atomic_int throttledReads;   // counted without stats_mutex, see handle_request
+    atomic_int throttledWrites;
+    atomic_int shedRequests;
+    atomic_int rejectedLogins;
+    atomic_int reattached;     // reconnects served by the user's existing thread
+    atomic_int idleTimeouts;   // connections closed after idle_seconds of silence
+    atomic_int reclaimed;      // exited client threads joined and freed
+} stats_t;   
+
+extern stats_t curStats;
+
+//rosters of a course, the rest of it is in the published catalog_t. One per cache line
+typedef struct __attribute__((aligned(CACHE_LINE))) {
+    vector_t * enrollment; 
+    vector_t * waitlist;   
+    vector_t * holds;    // hold_t, seats offered to the waitlist
+    uint32_t waitHead;   // sequence number of the first waitlist entry
+    uint32_t waitTail;   // sequence number the next waitlist entry gets
+} course_t; 
+
+#define HOLD_PENDING 0
+#define HOLD_CLAIMED 1
+
+typedef struct {
+    wheel_timer_t timer;  // must stay first
+    char* username;
+    int course;
+    int state;
+} hold_t;
+
+extern course_t courseArray[32];
+
+//a course's lock, padded so cores locking neighbouring courses don't share a line
+typedef struct __attribute__((aligned(CACHE_LINE))) {
+    pthread_mutex_t mutex;
+} course_mutex_t;
+
+/*
+ * A logged in connection.
+ *
+ * local - copy of the user taken at login, as seen by this connection.
+ * user - the user's entry in userList.
+ * fd - client socket, only used by the transport.
+ * out - replies queued for the transport to send, outLen bytes of them.
+ * arrived - overload_clock() when the request being handled was read.
+ * buckets - RATE_READ and RATE_WRITE token buckets of this session.
+ * sched - SCHED reply for the user's courses, schedLen bytes, built from
+ *         the user's bitmaps schedEnrolled/schedWaitlisted/schedOffered.
+ *         Served as is until one changes; a reload cannot retitle a course.
+ */
+typedef struct {
+    user_t local;
+    user_t * user;
+    int fd;
+    char * out;
+    size_t outLen;
+    size_t outCap;
+    uint64_t arrived;
+    bucket_t buckets[2];
+    char * sched;
+    uint32_t schedLen;
+    uint32_t schedEnrolled;
+    uint32_t schedWaitlisted;
+    uint32_t schedOffered;
+} session_t;
+
+extern vector_t * userList;
+extern pthread_rwlock_t userList_rwlock;
+extern FILE * logFile;
+extern pthread_mutex_t logFile_mutex;
+extern pthread_mutex_t stats_mutex;
+extern course_mutex_t courseArray_mutexes[32];
+
+// settings, read by engine_init
+extern int max_clients;
+extern int queue_depth;
+extern int delay_target_ms;
+extern int read_rate;
+extern int write_rate;
+extern int hold_seconds;
+extern char * group_filename;
+extern char * completed_filename;
+extern char * admin_list;
+extern char * trace_file;
+extern int trace_sample;
+
+/*
+ * How often a lock was found taken. Only contended acquisitions are
+ * counted, the uncontended path is a single trylock.
+ */
+typedef struct __attribute__((aligned(CACHE_LINE))) {
+    atomic_long contended;
+    atomic_long waitNs;    // total time spent waiting for the lock
+} lock_stats_t;
+
+extern lock_stats_t courseLockStats;
+extern lock_stats_t logLockStats;
+extern lock_stats_t userLockStats;
+
+/*
+ * Set up users, courses and the log from the settings above. Starts the
+ * timer wheel thread for seat holds; no other threads are started.
+ *
+ * @return number of courses read
+ */
+int engine_init(const char * course_filename, const char * log_filename);
+
+/*
+ * Print the state of every course to stdout and every user and the
+ * counters to stderr. Called once requests have stopped.
+ */
+void engine_dump();
+
+// locks of the shared state, counting contention
+void course_lock(int index);
+void course_unlock(int index);
+void log_lock();
+void log_unlock();
+void users_rdlock();
+void users_wrlock();
+void users_unlock();
+
+int user_comparator(const void * a, const void * b);
+int read_courses(const char * file_name);
+user_t * find_user(const char * username);
+const char * enroll_precheck(user_t * user, int index);
+char * next_waitlisted(int index);
+char * offer_seat(int index, int quiet);
+char * fill_seat(int index, int quiet);
+int reload_courses(const char * username);
+int claim_hold(int index, user_t * user);
+user_t * login_user(int client_fd, const char * username);
+void reject_login(const char * username);
+void memory_report(char * buf, size_t len);
+const char * request_name(uint8_t type);
+int handle_request(session_t * session, petrV_header * request, char * body);
+void session_init(session_t * session, user_t * user, int fd);
+void session_release(session_t * session);
+void session_reply(session_t * session, petrV_header * h, char * msgbuf);
+void session_busy(session_t * session, petrV_header * h, int retry_ms);
+
+#endif
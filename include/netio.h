@@ -0,0 +1,151 @@
+#ifndef NETIO_H
+#define NETIO_H
+
+#include <pthread.h>
+#include <signal.h>
+#include "server.h"
+
+#define BACKEND_BLOCKING 0
+#define BACKEND_EPOLL 1
+#define BACKEND_URING 2
+
+#define CONN_READ_SIZE 4096
+
+#define CONN_HEADER 0
+#define CONN_BODY 1
+
+#define KEEPALIVE_IDLE 60       // seconds of silence before the first probe
+#define KEEPALIVE_INTERVAL 10   // seconds between probes
+#define KEEPALIVE_COUNT 3       // unanswered probes before the connection is dropped
+
+extern volatile sig_atomic_t shutdown_flag;
+extern int idle_seconds;
+extern int linger_seconds;
+
+/*
+ * CPU placement, set with -P. Threads that serve clients are pinned to
+ * "slots", the CPUs of the list in order, and each connection is served
+ * on the slot its packets arrive on where the backend can arrange it.
+ * Without -P nothing is pinned and every call below is a no-op.
+ */
+
+/*
+ * Parse a -P list such as "0-3,6".
+ *
+ * @return number of CPUs in it, -1 if it is malformed
+ */
+int pin_parse(const char * list);
+int pin_count();
+
+/*
+ * Pin the calling thread to a slot, taken modulo the number of CPUs.
+ *
+ * @return the CPU, -1 without -P or if the CPU is not available
+ */
+int pin_thread(int slot);
+
+/*
+ * Slot of the CPU the kernel delivers fd's packets on (SO_INCOMING_CPU),
+ * or the next slot round robin if that CPU is not in the list.
+ */
+int pin_slot(int fd);
+
+/*
+ * Open another nonblocking listening socket on listen_fd's port, in the
+ * same SO_REUSEPORT group. The kernel prefers it for connections whose
+ * packets arrive on cpu.
+ *
+ * @return the socket, -1 on failure
+ */
+int listener_clone(int listen_fd, int cpu);
+
+/*
+ * Per connection state of the event loop backends. This is everything
+ * process_client kept on its thread's stack, so a connection resumes
+ * wherever the last recv left it.
+ *
+ * session - valid once loggedIn is set.
+ * state - CONN_HEADER while reading a header, CONN_BODY while reading its body.
+ * header - the message being read, only the first got bytes while in CONN_HEADER.
+ * body - msg_len + 1 bytes while in CONN_BODY, got of them received.
+ * closing - set once the connection should be closed after its replies are sent.
+ */
+typedef struct {
+    session_t session;
+    int loggedIn;
+    int state;
+    petrV_header header;
+    uint32_t got;
+    char * body;
+    int closing;
+} conn_t;
+
+/*
+ * Send what the engine queued in a session, blocking until it is out.
+ * Used by the thread per client backend.
+ */
+void session_send(session_t * session);
+
+/*
+ * Turn on TCP keepalive for a client socket, so a peer that vanished
+ * without closing is noticed in about two minutes instead of never.
+ */
+void socket_keepalive(int fd);
+
+/*
+ * Serve a logged in user on fd from the thread per client backend. A
+ * user whose thread is still around gets fd handed to it, any connection
+ * that thread was serving is closed; otherwise a new thread is started.
+ *
+ * @return -1 if no thread could be started, the caller still owns fd
+ */
+int client_attach(user_t * user, int fd);
+
+/*
+ * Join and free the client threads that have exited. Called by the
+ * acceptor after every accept.
+ */
+void client_reap();
+
+/*
+ * Close every client connection and wait for all client threads to exit.
+ * Called from the SIGINT handler.
+ */
+void blocking_stop();
+
+conn_t * conn_new(int fd);
+void conn_free(conn_t * conn);
+
+/*
+ * Feed received bytes to a connection. Every complete petrV message is
+ * handled in order; replies are queued in conn->session.out. A message
+ * body longer than BUFFER_SIZE closes the connection.
+ *
+ * @return -1 if the connection should be closed once its replies are sent
+ */
+int conn_input(conn_t * conn, const char * data, size_t len);
+
+/*
+ * Serve clients from the given number of scheduler threads, each running
+ * its own epoll loop over the connections it accepted. Returns once the
+ * server shuts down.
+ */
+int run_epoll(int listen_fd, int threads);
+
+/*
+ * Wake every epoll scheduler thread and wait for them to finish the
+ * requests they are in the middle of. Called from the SIGINT handler.
+ */
+void epoll_stop();
+
+/*
+ * Serve clients from a single io_uring loop until shutdown.
+ * SIGINT is blocked except while the loop waits for completions, so the
+ * handler only has to set shutdown_flag.
+ *
+ * @return -1 without serving anyone if the kernel lacks io_uring (or the
+ *         multishot accept/recv and provided buffer rings it relies on)
+ */
+int run_uring(int listen_fd);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef OVERLOAD_H
+#define OVERLOAD_H
+
+#include <stdint.h>
+
+#define OVERLOAD_INTERVAL_US 100000  // how long the delay has to stay above target before shedding
+#define OVERLOAD_DEFAULT_TARGET_MS 5
+#define OVERLOAD_DEFAULT_DEPTH 64    // queued mutating requests per worker
+
+/*
+ * Set the limits. Called once at startup.
+ *
+ * @param max_clients logged in connections allowed at once, 0 for no limit
+ * @param queue_depth requests allowed to wait for admission per worker, 0 for no limit
+ * @param workers admission slots, the queue holds queue_depth * workers
+ * @param target_ms queueing delay tolerated before shedding, 0 never sheds on delay
+ */
+void overload_init(int max_clients, int queue_depth, int workers, int target_ms);
+
+/*
+ * Microseconds on the clock request arrival times are kept on.
+ */
+uint64_t overload_clock();
+
+/*
+ * Count a login against the connection limit.
+ *
+ * @return 0 if the client may stay, -1 if the server is full and the
+ *         connection has to be turned away with ESERV
+ */
+int overload_connect();
+void overload_disconnect();
+
+/*
+ * Called as a request is about to queue for admission.
+ *
+ * @param waiting requests already queued
+ * @return 0 if it may queue, -1 if the queue is full
+ */
+int overload_queue(unsigned long waiting);
+
+/*
+ * CoDel check, called as a request leaves the admission queue. Once the
+ * queueing delay has stayed above target for a whole interval, requests
+ * are shed at a rate that grows with the square root of how many have
+ * been shed, until the delay falls back under target.
+ *
+ * @param arrived overload_clock() when the request was read off the socket
+ * @return 0 to serve the request, -1 to shed it
+ */
+int overload_dequeue(uint64_t arrived);
+
+/*
+ * How long a shed client should wait before retrying, in ms. Sent as the
+ * body of the ESERV reply.
+ */
+int overload_retry_after();
+
+#endif
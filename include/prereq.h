@@ -0,0 +1,41 @@
+#ifndef PREREQ_H
+#define PREREQ_H
+
+#include <stdint.h>
+
+/*
+ * Parse a comma separated list of course indices, e.g. "0,3,5".
+ *
+ * @return bitmask with one bit per course
+ */
+uint32_t parse_course_set(char * value);
+
+/*
+ * Check that the prerequisite graph is a DAG, depth first over the
+ * direct prerequisites. Only run when a catalog is read; ENROLL and WAIT
+ * check the direct prerequisites of a course against what the user has
+ * completed.
+ *
+ * @param prereqs direct prerequisites of each course
+ * @param course_cnt number of courses
+ * @return -1 if some course ends up being its own prerequisite, 0 otherwise
+ */
+int check_prereqs(const uint32_t * prereqs, int course_cnt);
+
+/*
+ * Load the courses each user has completed. Each line is
+ * "username;0,3,5". Called once at startup, before any client connects.
+ *
+ * @param file_name completed course file, NULL if nobody has completed anything
+ */
+void load_completed(const char * file_name);
+
+/*
+ * Look up the completed courses of a user. Called once per login,
+ * O(log n) over the completed course file.
+ *
+ * @return bitmask of completed course indices
+ */
+uint32_t lookup_completed(const char * username);
+
+#endif
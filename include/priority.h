@@ -0,0 +1,53 @@
+#ifndef PRIORITY_H
+#define PRIORITY_H
+
+#include <stdint.h>
+
+#define PRIORITY_GROUPS 4   // group 0 registers first, unlisted users are in the last group
+
+/*
+ * Load the priority group of each user. Each line is "username;group".
+ * Called once at startup, before any client connects.
+ *
+ * @param file_name group file, NULL puts every user in the last group
+ */
+void load_groups(const char * file_name);
+
+/*
+ * Look up the group a user registers with. Called once per login,
+ * O(log n) over the group file.
+ *
+ * @return group in [0, PRIORITY_GROUPS)
+ */
+int lookup_group(const char * username);
+
+/*
+ * Parse the "open=" field of a course line into a window table. Offsets
+ * are seconds after server start, one per group; missing groups open with
+ * the last listed one.
+ *
+ * @param value text after "open=", e.g. "0,3600,7200"
+ * @param open_at PRIORITY_GROUPS entries, absolute times in ms
+ */
+void parse_window(char * value, uint64_t * open_at);
+
+/*
+ * Milliseconds on the clock the windows are kept on.
+ */
+uint64_t window_clock();
+
+/*
+ * Admission queue for mutating requests. At most `slots` requests hold
+ * a course mutex at once, the rest wait in arrival order so a window
+ * opening does not turn into every thread piling onto the same mutex.
+ *
+ * admission_enter refuses requests the overload limits say to shed.
+ * @param arrived overload_clock() when the request was read
+ * @return 0 once admitted, -1 if the request has to be answered with
+ *         ESERV (admission_exit must not be called then)
+ */
+void admission_init(int slots);
+int admission_enter(uint64_t arrived);
+void admission_exit();
+
+#endif
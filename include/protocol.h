@@ -13,6 +13,11 @@ enum msg_types {
     ENROLL,
     DROP,
     WAIT,
+    CONTESTED,
+    STATS,
+    RELOAD,
+    SWAP,
+    WAITPOS,
     EUSRLGDIN = 0xF0,
     ECDENIED,
     ECNOTFOUND,
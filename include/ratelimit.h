@@ -0,0 +1,39 @@
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdint.h>
+
+#define RATE_READ 0    // CLIST, SCHED, CONTESTED, STATS, WAITPOS
+#define RATE_WRITE 1   // ENROLL, WAIT, DROP, SWAP
+
+/*
+ * Token bucket. Owned by one session and only touched by the thread
+ * serving it, so taking a token needs no lock.
+ *
+ * tokens - millionths of a token left, refilled lazily on each take.
+ * last - overload_clock() of the last refill, 0 for a fresh bucket.
+ */
+typedef struct {
+    uint64_t tokens;
+    uint64_t last;
+} bucket_t;
+
+/*
+ * Set the budgets. Each bucket holds up to one second's worth of tokens.
+ * Called once at startup.
+ *
+ * @param read_rate RATE_READ requests per second per session, 0 for no limit
+ * @param write_rate RATE_WRITE requests per second per session, 0 for no limit
+ */
+void ratelimit_init(int read_rate, int write_rate);
+
+/*
+ * Take one token for a request of the given kind.
+ *
+ * @param bucket the session's bucket for kind
+ * @param now overload_clock()
+ * @return 0 if the request may run, otherwise ms until a token is back
+ */
+int ratelimit_take(bucket_t * bucket, int kind, uint64_t now);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+
+#define SLOT_MINUTES 5
+#define WEEK_SLOTS (7 * 24 * 60 / SLOT_MINUTES)
+#define WEEK_WORDS ((WEEK_SLOTS + 63) / 64)
+
+/*
+ * Bitset over the week in SLOT_MINUTES slots, Monday 00:00 first.
+ */
+typedef struct {
+    uint64_t w[WEEK_WORDS];
+} weekmask_t;
+
+/*
+ * Parse the "meet=" field of a course line. Blocks are separated by commas,
+ * each is one or more day letters (MTWRFSU) followed by HHMM-HHMM,
+ * e.g. "MWF1000-1050,R1400-1520".
+ *
+ * @param value text after "meet="
+ * @param out mask to fill
+ * @return 0 on success, -1 if a block could not be parsed
+ */
+int parse_meetings(char * value, weekmask_t * out);
+
+/*
+ * @return 1 if the two masks share a slot
+ */
+int weekmask_overlaps(const weekmask_t * a, const weekmask_t * b);
+
+#endif
@@ -11,47 +11,39 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
-#include "linkedlist.h"
+#include "engine.h"
 
-#define BUFFER_SIZE 1024
 #define SA struct sockaddr
 
-#define USAGE_MSG "./bin/zotReg_server [-h] PORT_NUMBER COURSE_FILENAME LOG_FILENAME"\
+#define USAGE_MSG "./bin/zotReg_server [-h] [-b BACKEND] [-t THREADS] [-P CPU_LIST] [-m MAX_CLIENTS] [-q QUEUE_DEPTH] [-D DELAY_MS] [-r READ_RATE] [-w WRITE_RATE] [-i IDLE_SECONDS] [-L LINGER_SECONDS] [-T TRACE_FILE] [-S SAMPLE] [-H HOLD_SECONDS] [-g GROUP_FILENAME] [-c DONE_FILENAME] [-a ADMINS] PORT_NUMBER COURSE_FILENAME LOG_FILENAME"\
                   "\n  -h                 Displays this help menu and returns EXIT_SUCCESS."\
+                  "\n  -b BACKEND         Network backend: blocking (default, one thread per client), epoll or uring."\
+                  "\n  -t THREADS         Scheduler threads multiplexing the connections with -b epoll (default: one per CPU, or per -P CPU)."\
+                  "\n  -P CPU_LIST        Pin client threads to these CPUs (\"0-3,6\"), serving each connection on the one its packets arrive on."\
+                  "\n  -m MAX_CLIENTS     Logged in clients allowed at once, later logins get ESERV (default: no limit)."\
+                  "\n  -q QUEUE_DEPTH     ENROLL/WAIT/DROP allowed to queue per worker before ESERV (default 64, 0: no limit)."\
+                  "\n  -D DELAY_MS        Queueing delay target, shed ENROLL/WAIT/DROP with ESERV while above it (default 5, 0: off)."\
+                  "\n  -r READ_RATE       CLIST/SCHED/WAITPOS/CONTESTED/STATS requests per second per client, ESERV past that (default: no limit)."\
+                  "\n  -w WRITE_RATE      ENROLL/WAIT/DROP/SWAP requests per second per client, ESERV past that (default: no limit)."\
+                  "\n  -i IDLE_SECONDS    Close a connection that sends nothing for this long with -b blocking (default 600, 0: never)."\
+                  "\n  -L LINGER_SECONDS  Keep a disconnected user's thread this long for a reconnect to reuse (default 30)."\
+                  "\n  -T TRACE_FILE      Trace sampled requests into a Chrome trace file (chrome://tracing, Perfetto)."\
+                  "\n  -S SAMPLE          Trace one request in SAMPLE per thread with -T (default 100)."\
+                  "\n  -H HOLD_SECONDS    Hold a freed seat for the next waitlisted student this long instead of enrolling them."\
+                  "\n  -g GROUP_FILENAME  File of \"username;group\" lines. Group 0 registers first, unlisted users register last."\
+                  "\n  -c DONE_FILENAME   File of \"username;0,3,5\" lines, the course indices each user has completed."\
+                  "\n  -a ADMINS          Comma separated users allowed to RELOAD and query CONTESTED and STATS (default: none)."\
                   "\n  PORT_NUMBER        Port number to listen on."\
                   "\n  COURSE_FILENAME    File to read course information from at the start of the server"\
-                  "\n  LOG_FILENAME       File to output server actions into. Create/overwrite, if exists\n"
-
-
-typedef struct {
-    int clientCnt;  
-    int threadCnt;  
-    int totalAdds;  
-    int totalDrops; 
-} stats_t;   
-
-stats_t curStats;  
-
-typedef struct {
-    char* username;	
-    int socket_fd;	
-    pthread_t tid;
-    uint32_t enrolled;	
-    uint32_t waitlisted;
-} user_t;
-
-typedef struct {
-    char* title; 
-    int   maxCap;      
-    list_t * enrollment; 
-    list_t * waitlist;   
-} course_t; 
-
-course_t courseArray[32]; 
-
-// INSERT FUNCTIONS HERE
-int user_comparator(const void * a, const void * b);
-int read_courses(const char * file_name);
-
+                  "\n  LOG_FILENAME       File to output server actions into. Create/overwrite, if exists\n"\
+                  "\nCourse lines are \"title;capacity\" optionally followed by \";open=S0,S1,...\", the seconds after"\
+                  "\nstartup at which each priority group may ENROLL or WAIT, and by \";meet=MWF1000-1050,...\","\
+                  "\nits weekly meeting times, by \";prereq=0,3\" courses that must be completed and by \";coreq=2\""\
+                  "\ncourses that must be completed or enrolled in. ENROLL and WAIT reject courses that overlap an"\
+                  "\nenrolled one or whose requirements are not met. A RELOAD request (-a) re-reads COURSE_FILENAME; courses keep"\
+                  "\ntheir index and rosters, new ones may be appended and raised capacities fill from the waitlist."\
+                  "\nA SWAP request with body \"FROM,TO\" drops FROM and enrolls in TO in one step, or changes nothing."\
+                  "\nA WAITPOS request with a course index answers with the caller's place in that waitlist, or that a seat"\
+                  "\nis held for them (-H); SCHED lists held seats as (HELD) until they ENROLL into them.\n"
 
 #endif
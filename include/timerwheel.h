@@ -0,0 +1,57 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_TICK_MS 100
+
+/*
+ * A timer that can sit on the wheel. Embed it as the first member of the
+ * structure it belongs to so the callback can cast back to it.
+ *
+ * next/prev - links in the wheel slot, only valid while armed.
+ * expires - tick the timer fires on.
+ * armed - 1 while on the wheel. Cleared before the callback runs.
+ * callback - called from the wheel thread, without any wheel lock held.
+ */
+typedef struct wheel_timer {
+    struct wheel_timer* next;
+    struct wheel_timer* prev;
+    uint64_t expires;
+    int armed;
+    void (*callback)(struct wheel_timer*);
+} wheel_timer_t;
+
+/*
+ * Start the thread that drives the wheel, one tick every WHEEL_TICK_MS.
+ */
+void timerwheel_start();
+
+/*
+ * Stop the wheel thread and wait for it to exit. A callback that is
+ * running finishes first, timers still armed never fire. Does nothing if
+ * the wheel was never started.
+ */
+void timerwheel_stop();
+
+/*
+ * Put a timer on the wheel. O(1).
+ *
+ * @param t timer with callback set, must not be armed
+ * @param delay_ms milliseconds from now, rounded up to whole ticks
+ */
+void timer_arm(wheel_timer_t* t, uint64_t delay_ms);
+
+/*
+ * Take a timer off the wheel. O(1).
+ *
+ * @param t timer
+ * @return 1 if the timer was still pending and will never fire, 0 if it has
+ *         already fired (its callback is running or has run)
+ */
+int timer_cancel(wheel_timer_t* t);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define TRACE_BUFFER 512   // spans a thread collects before writing them out
+
+/*
+ * Sampled request tracing. One request in every N is traced; its spans
+ * go to a buffer owned by the thread serving it and end up in a Chrome
+ * trace file (JSON array format), which chrome://tracing and Perfetto
+ * open directly.
+ *
+ * A span point costs one thread-local test while the current request is
+ * not sampled, so leaving the calls in costs nothing when tracing is off.
+ */
+
+extern __thread int trace_sampled;
+
+/*
+ * Start tracing. Called once at startup, before any client connects.
+ *
+ * @param file_name trace file, created/overwritten
+ * @param sample_every trace one request in this many, per thread
+ */
+void trace_init(const char * file_name, int sample_every);
+
+/*
+ * A new request starts on this thread, decide whether it is sampled.
+ * Does nothing unless trace_init was called.
+ */
+void trace_request();
+
+/*
+ * The request started by trace_request is done, nothing this thread
+ * does until the next one is traced.
+ */
+static inline void trace_request_end() {
+    trace_sampled = 0;
+}
+
+static inline uint64_t trace_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Append a span to this thread's buffer. Use the inline wrappers.
+ *
+ * @param name span name, must outlive the server (a string literal)
+ * @param detail shown with the span, NULL for none. Copied.
+ */
+void trace_record(const char * name, const char * detail, uint64_t start);
+
+/*
+ * Start of a span, 0 if the current request is not sampled.
+ */
+static inline uint64_t trace_start() {
+    return trace_sampled ? trace_clock() : 0;
+}
+
+/*
+ * End of a span begun with trace_start.
+ */
+static inline void trace_end(const char * name, uint64_t start) {
+    if (start != 0) {
+        trace_record(name, NULL, start);
+    }
+}
+
+static inline void trace_end_detail(const char * name, const char * detail, uint64_t start) {
+    if (start != 0) {
+        trace_record(name, detail, start);
+    }
+}
+
+/*
+ * Write out every thread's remaining spans and close the file. Called
+ * at shutdown once the threads serving clients have stopped.
+ */
+void trace_close();
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef USERSTORE_H
+#define USERSTORE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define USER_NAME_INLINE 16   // names shorter than this are kept in the user itself
+#define USER_CHUNK 1024       // users per chunk of the store
+#define USER_MAX_CHUNKS 1024  // so at most about a million users
+#define WAIT_SEQ_BITS 27      // waitlist sequence numbers are kept modulo 2^27
+#define WAIT_SEQ_MASK ((1u << WAIT_SEQ_BITS) - 1)
+
+/*
+ * The hot half of a user: what requests read and write. 48 bytes, so a
+ * course's worth of lookups stays in a few cache lines.
+ *
+ * username - points at name for short names, otherwise at a heap copy.
+ *            Never moves, rosters keep this pointer.
+ * id - index into the store, finds the cold half.
+ */
+typedef struct {
+    char* username;
+    uint32_t enrolled;
+    uint32_t waitlisted;
+    uint32_t offered;   // courses holding a seat for this user
+    uint32_t completed; // courses already taken, for prerequisites
+    int group;          // priority group, picks the registration window
+    uint32_t id;
+    char name[USER_NAME_INLINE];
+} user_t;
+
+/*
+ * The cold half: touched at login, on WAIT and at shutdown.
+ *
+ * admin - listed with -a, may RELOAD and query CONTESTED and STATS.
+ * client - the transport's state for this user, NULL if it keeps none.
+ *          Owned by the transport, see netio_blocking.c.
+ * waitSeq - one entry per course the user ever waited for, the course
+ *           index in the top 5 bits and the sequence number of the
+ *           waitlist entry below. Only meaningful while the waitlisted
+ *           bit of that course is set.
+ */
+typedef struct {
+    int socket_fd;
+    uint8_t waitCnt;
+    uint8_t waitCap;
+    uint8_t admin;
+    void * client;
+    uint32_t * waitSeq;
+} user_cold_t;
+
+/*
+ * Create a user in the store. Users are never freed or moved, a pointer
+ * to one stays valid for the life of the server. The caller serializes
+ * calls, the server holds userList_rwlock for writing.
+ *
+ * @return the new user, bitmaps zeroed
+ */
+user_t * user_new(const char * username);
+
+/*
+ * The cold half of a user. O(1), takes no lock.
+ */
+user_cold_t * user_cold(const user_t * user);
+
+/*
+ * Remember or look up the sequence number of the user's entry in a
+ * waitlist. Most users wait for one or two courses, so the table only
+ * grows per course actually waited for. Same locking as the bitmaps
+ * they go with.
+ */
+void user_set_wait_seq(user_t * user, int course, uint32_t seq);
+uint32_t user_wait_seq(const user_t * user, int course);
+
+/*
+ * Bytes the store holds: chunks, long names and sequence number tables.
+ * Chunks are allocated whole, so with few users most slots are empty.
+ *
+ * @param count set to the number of users
+ * @param slots set to the users the allocated chunks have room for
+ * @param heap set to the bytes of long names and sequence number tables
+ */
+size_t userstore_bytes(int * count, int * slots, size_t * heap);
+
+#endif
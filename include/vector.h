@@ -0,0 +1,97 @@
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <stdio.h>
+
+#include <stdlib.h>
+#include <assert.h>
+#include <stdbool.h>
+
+/*
+ * Structure for the base vector, a growable ring of pointers
+ *
+ * data - capacity slots, element i lives in data[(head + i) & (capacity - 1)].
+ * head - slot of the first element.
+ * length - the current number of elements.
+ * capacity - number of slots, always a power of two.
+ * comparator - function pointer to vector comparator. Needed by the Sorted functions.
+ */
+typedef struct vector {
+    void** data;
+    int head;
+    int length;
+    int capacity;
+    /* the comparator uses the values of the elements directly (i.e function has to be type aware) */
+    int (*comparator)(const void*, const void*);
+    void (*printer)(void*, void*);  // function pointer for printing the data stored
+    void (*deleter)(void*);         // function pointer for deleting any dynamically
+                                    // allocated items within the data stored
+} vector_t;
+
+// Functions implemented/provided in vector.c
+vector_t* CreateVector(int (*compare)(const void*, const void*), void (*print)(void*,void*),
+                       void (*delete)(void*));
+
+/*
+ * Element index of the vector, indexed by 0.
+ * @param vec pointer to the vector struct
+ * @param index position, must be below vec->length
+ * @return the element stored there
+ */
+static inline void* VectorAt(vector_t* vec, int index) {
+    return vec->data[(vec->head + index) & (vec->capacity - 1)];
+}
+
+/*
+ * Amortized O(1) insertion at either end of the vector.
+ * @param vec pointer to the vector struct
+ * @param val_ref element to store, NULL is ignored
+ */
+void PushFront(vector_t* vec, void* val_ref);
+void PushBack(vector_t* vec, void* val_ref);
+
+/*
+ * Each of these functions removes a single element from the vector.
+ * PopFront and PopBack are O(1). RemoveAt keeps the order of the other
+ * elements, SwapRemove moves the last element into the gap instead and
+ * is O(1).
+ * @param vec pointer to the vector struct
+ * @return the removed element, NULL if there was none
+ */
+void* PopFront(vector_t* vec);
+void* PopBack(vector_t* vec);
+void* RemoveAt(vector_t* vec, int index);
+void* SwapRemove(vector_t* vec, int index);
+
+/*
+ * Linear search for an element by pointer.
+ * @return its index, -1 if it is not in the vector
+ */
+int IndexOf(vector_t* vec, void* val_ref);
+
+/*
+ * Sorted vector functions, they keep the vector in comparator order
+ * and replace InsertInOrder and the walks looking for a key.
+ *
+ * InsertSorted places val_ref after any equal elements.
+ * FindSorted binary searches for an element comparing equal to key.
+ * @return index of the match, -1 if there is none
+ */
+void InsertSorted(vector_t* vec, void* val_ref);
+int FindSorted(vector_t* vec, const void* key);
+
+/*
+ * Remove all elements, calling the deleter on each if there is one.
+ *
+ * @param vec pointer to the vector struct
+ */
+void DeleteVector(vector_t* vec);
+
+/*
+ * Print each element in the current order.
+ * @param vec pointer to the vector struct
+ * @param fp open file pointer to print output to
+ */
+void PrintVector(vector_t* vec, FILE* fp);
+
+#endif
@@ -0,0 +1,146 @@
+#include "catalog.h"
+#include "prereq.h"
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    The course catalog is published RCU style. Readers pin whatever
+    catalog is current and use it without locks; a reload builds a whole
+    new catalog, swaps the pointer and only frees the old one after a
+    grace period.
+
+    The grace period uses two reader counters picked by the parity of an
+    epoch. A reader counts itself under the current epoch, and retries if
+    the epoch moved before it loaded the pointer. After swapping the
+    pointer the writer bumps the epoch, so new readers count under the
+    other parity, and waits for the old parity's counter to drain. Every
+    reader that could have loaded the old pointer is in that counter.
+*/
+
+static _Atomic(catalog_t *) current = NULL;
+static atomic_ulong epoch = 0;
+static atomic_long readers[2];
+
+static __thread int pinDepth = 0;
+static __thread int pinParity = 0;
+static __thread catalog_t * pinned = NULL;
+
+static void set_err(char * err, size_t err_len, const char * msg) {
+    snprintf(err, err_len, "%s", msg);
+}
+
+static void free_catalog(catalog_t * cat) {
+    for (int i = 0; i < cat->count; ++i) {
+        free(cat->courses[i].title);
+        free(cat->courses[i].meets);
+    }
+    free(cat);
+}
+
+catalog_t * load_catalog(const char * file_name, char * err, size_t err_len) {
+    FILE * f = fopen(file_name, "r");
+    if (!f) {
+        set_err(err, err_len, "ERROR: Could not open course file");
+        return NULL;
+    }
+
+    catalog_t * cat = calloc(1, sizeof(catalog_t));
+    char line[256];
+    while (cat->count < 32 && fgets(line, sizeof(line), f)) {
+        char * save = NULL;
+        char * title = strtok_r(line, ";", &save);
+        char * temp = strtok_r(NULL, ";", &save);
+        if (title == NULL || temp == NULL) {
+            continue;
+        }
+        course_info_t * course = &cat->courses[cat->count];
+        course->title = strdup(title);
+        course->maxCap = atoi(temp);
+        cat->count++;
+
+        //optional key=value fields after the capacity
+        char * field;
+        while ((field = strtok_r(NULL, ";\r\n", &save)) != NULL) {
+            if (strncmp(field, "open=", 5) == 0) {
+                parse_window(field + 5, course->open_at);
+            } else if (strncmp(field, "meet=", 5) == 0) {
+                course->meets = malloc(sizeof(weekmask_t));
+                if (parse_meetings(field + 5, course->meets) != 0) {
+                    snprintf(err, err_len, "ERROR: Could not parse meeting times of course %d", cat->count - 1);
+                    fclose(f);
+                    free_catalog(cat);
+                    return NULL;
+                }
+            } else if (strncmp(field, "prereq=", 7) == 0) {
+                course->prereqs = parse_course_set(field + 7);
+            } else if (strncmp(field, "coreq=", 6) == 0) {
+                course->coreqs = parse_course_set(field + 6);
+            }
+        }
+    }
+    fclose(f);
+
+    //prerequisites have to form a DAG or nobody could ever take some courses
+    uint32_t prereqs[32];
+    for (int i = 0; i < cat->count; ++i) {
+        prereqs[i] = cat->courses[i].prereqs;
+    }
+    if (check_prereqs(prereqs, cat->count) != 0) {
+        set_err(err, err_len, "ERROR: Course prerequisites contain a cycle");
+        free_catalog(cat);
+        return NULL;
+    }
+
+    //precompute which courses meet at the same time, checks are then one AND
+    for (int i = 0; i < cat->count; ++i) {
+        for (int j = 0; j < cat->count; ++j) {
+            if (i != j && cat->courses[i].meets != NULL && cat->courses[j].meets != NULL &&
+                weekmask_overlaps(cat->courses[i].meets, cat->courses[j].meets)) {
+                cat->courses[i].conflicts |= (1 << j);
+            }
+        }
+    }
+
+    return cat;
+}
+
+catalog_t * catalog_enter() {
+    if (pinDepth++ > 0) {
+        return pinned;
+    }
+
+    while (1) {
+        unsigned long e = atomic_load(&epoch);
+        atomic_fetch_add(&readers[e & 1], 1);
+        if (atomic_load(&epoch) == e) {
+            pinParity = e & 1;
+            break;
+        }
+        atomic_fetch_sub(&readers[e & 1], 1);
+    }
+    pinned = atomic_load(&current);
+    return pinned;
+}
+
+void catalog_exit() {
+    if (--pinDepth == 0) {
+        pinned = NULL;
+        atomic_fetch_sub(&readers[pinParity], 1);
+    }
+}
+
+void catalog_publish(catalog_t * next) {
+    catalog_t * old = atomic_exchange(&current, next);
+    unsigned long e = atomic_fetch_add(&epoch, 1);
+
+    // grace period, readers hold their pin for one request at most
+    while (atomic_load(&readers[e & 1]) != 0) {
+        sched_yield();
+    }
+    if (old != NULL) {
+        free_catalog(old);
+    }
+}
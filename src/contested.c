@@ -0,0 +1,183 @@
+#include "contested.h"
+#include "engine.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+    Indexed max-heap over course indices.
+
+    heap[] holds course indices in heap order, pos[] maps a course index back
+    to its slot in heap[] so a single course can be re-ranked in place with one
+    sift instead of a rebuild. key[] is the snapshot the course was last ranked
+    with.
+
+    Writers never take contested_mutex. Under the course mutex they publish
+    the course's counts in live[] and mark it in dirty; the next
+    contested_top re-ranks just the marked courses before walking the heap,
+    so ENROLL, DROP and WAIT on different courses share no lock here.
+*/
+
+typedef struct __attribute__((aligned(CACHE_LINE))) {
+    _Atomic uint64_t counts;   // waitlist length << 32 | enrollment length
+} live_t;
+
+static int heap[32];
+static int pos[32];
+static contested_key_t key[32];
+static int heapLen = 0;
+static live_t live[32];
+static atomic_uint dirty = 0;   // courses whose live[] changed since they were last ranked
+static pthread_mutex_t contested_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* > 0 if course a is more contested than course b */
+static int contested_cmp(int a, int b) {
+    const contested_key_t* A = &key[a];
+    const contested_key_t* B = &key[b];
+    if (A->waiting != B->waiting)
+        return A->waiting - B->waiting;
+
+    // compare enrolled/maxCap without dividing
+    long long fa = (long long)A->enrolled * (B->maxCap > 0 ? B->maxCap : 1);
+    long long fb = (long long)B->enrolled * (A->maxCap > 0 ? A->maxCap : 1);
+    if (fa != fb)
+        return fa > fb ? 1 : -1;
+
+    // stable order for ties, lower course index first
+    return b - a;
+}
+
+static void heap_swap(int i, int j) {
+    int tmp = heap[i];
+    heap[i] = heap[j];
+    heap[j] = tmp;
+    pos[heap[i]] = i;
+    pos[heap[j]] = j;
+}
+
+static void sift_up(int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (contested_cmp(heap[i], heap[parent]) <= 0)
+            break;
+        heap_swap(i, parent);
+        i = parent;
+    }
+}
+
+static void sift_down(int i) {
+    while (1) {
+        int best = i;
+        int l = 2 * i + 1;
+        int r = 2 * i + 2;
+        if (l < heapLen && contested_cmp(heap[l], heap[best]) > 0)
+            best = l;
+        if (r < heapLen && contested_cmp(heap[r], heap[best]) > 0)
+            best = r;
+        if (best == i)
+            break;
+        heap_swap(i, best);
+        i = best;
+    }
+}
+
+//must hold the course mutex
+static void publish(int index) {
+    uint64_t counts = (uint64_t)courseArray[index].waitlist->length << 32 |
+                      (uint32_t)courseArray[index].enrollment->length;
+    atomic_store(&live[index].counts, counts);
+}
+
+//must hold contested_mutex
+static void snapshot(int index) {
+    uint64_t counts = atomic_load(&live[index].counts);
+    key[index].waiting = counts >> 32;
+    key[index].enrolled = (uint32_t)counts;
+    key[index].maxCap = catalog_enter()->courses[index].maxCap;
+    catalog_exit();
+}
+
+void contested_init(int course_cnt) {
+    pthread_mutex_lock(&contested_mutex);
+    heapLen = 0;
+    for (int i = 0; i < course_cnt && i < 32; ++i) {
+        publish(i);
+        snapshot(i);
+        heap[heapLen] = i;
+        pos[i] = heapLen;
+        heapLen++;
+        sift_up(heapLen - 1);
+    }
+    pthread_mutex_unlock(&contested_mutex);
+}
+
+void contested_grow(int course_cnt) {
+    pthread_mutex_lock(&contested_mutex);
+    for (int i = heapLen; i < course_cnt && i < 32; ++i) {
+        publish(i);
+        snapshot(i);
+        heap[heapLen] = i;
+        pos[i] = heapLen;
+        heapLen++;
+        sift_up(heapLen - 1);
+    }
+    pthread_mutex_unlock(&contested_mutex);
+}
+
+void contested_update(int index) {
+    if (index < 0 || index >= 32)
+        return;
+
+    publish(index);
+    // an already marked course is left alone, so between queries dirty is only read.
+    // seq_cst: a query that clears the mark after this load also sees the counts above
+    unsigned bit = 1u << index;
+    if (!(atomic_load(&dirty) & bit))
+        atomic_fetch_or(&dirty, bit);
+}
+
+int contested_top(int k, int count, int* out, contested_key_t* keys) {
+    // best-first walk of the heap: the next most contested course is always
+    // a child of one already returned, so only O(k) slots are ever looked at
+    int frontier[32];
+    int frontierLen = 0;
+    int n = 0;
+
+    pthread_mutex_lock(&contested_mutex);
+    unsigned changed = atomic_exchange(&dirty, 0);
+    for (int i = 0; i < heapLen; ++i) {
+        if (changed & (1u << i)) {
+            snapshot(i);
+            sift_up(pos[i]);
+            sift_down(pos[i]);
+        }
+    }
+
+    if (heapLen > 0)
+        frontier[frontierLen++] = 0;
+
+    while (n < k && frontierLen > 0) {
+        int best = 0;
+        for (int i = 1; i < frontierLen; ++i) {
+            if (contested_cmp(heap[frontier[i]], heap[frontier[best]]) > 0)
+                best = i;
+        }
+        int slot = frontier[best];
+        frontier[best] = frontier[--frontierLen];
+
+        // courses a reload added after the caller pinned its catalog are passed over
+        if (heap[slot] < count) {
+            out[n] = heap[slot];
+            if (keys != NULL)
+                keys[n] = key[heap[slot]];
+            n++;
+        }
+
+        if (2 * slot + 1 < heapLen)
+            frontier[frontierLen++] = 2 * slot + 1;
+        if (2 * slot + 2 < heapLen)
+            frontier[frontierLen++] = 2 * slot + 2;
+    }
+    pthread_mutex_unlock(&contested_mutex);
+
+    return n;
+}
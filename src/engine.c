@@ -0,0 +1,1308 @@
+#include "engine.h"
+#include "contested.h"
+#include <unistd.h>
+
+/*
+    The registration engine: users, course rosters and everything a
+    logged in session can ask for. Nothing in here touches a socket.
+    Replies are queued in the session and whoever drives the engine, the
+    server's network backends or a benchmark, sends them on.
+*/
+
+//engine state
+stats_t curStats __attribute__((aligned(CACHE_LINE)));
+course_t courseArray[32];
+
+pthread_mutex_t stats_mutex __attribute__((aligned(CACHE_LINE)));
+
+vector_t * userList;
+pthread_rwlock_t userList_rwlock;
+
+FILE * logFile;
+pthread_mutex_t logFile_mutex;
+
+course_mutex_t courseArray_mutexes[32];
+pthread_mutex_t reload_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int max_clients = 0;
+int queue_depth = OVERLOAD_DEFAULT_DEPTH;
+int delay_target_ms = OVERLOAD_DEFAULT_TARGET_MS;
+int read_rate = 0;
+int write_rate = 0;
+int hold_seconds = 0;
+char * group_filename = NULL;
+char * completed_filename = NULL;
+char * admin_list = NULL;
+const char * course_file = NULL;
+char * trace_file = NULL;
+int trace_sample = 100;
+//engine state end
+
+lock_stats_t courseLockStats;
+lock_stats_t logLockStats;
+lock_stats_t userLockStats;
+
+//the lock was taken, count the wait
+static void lock_waited(lock_stats_t * stats, uint64_t start) {
+    atomic_fetch_add(&stats->contended, 1);
+    atomic_fetch_add(&stats->waitNs, trace_clock() - start);
+}
+
+void course_lock(int index) {
+    if (pthread_mutex_trylock(&courseArray_mutexes[index].mutex) == 0) {
+        return;
+    }
+    uint64_t start = trace_clock();
+    pthread_mutex_lock(&courseArray_mutexes[index].mutex);
+    lock_waited(&courseLockStats, start);
+}
+
+void course_unlock(int index) {
+    pthread_mutex_unlock(&courseArray_mutexes[index].mutex);
+}
+
+void log_lock() {
+    if (pthread_mutex_trylock(&logFile_mutex) == 0) {
+        return;
+    }
+    uint64_t start = trace_clock();
+    pthread_mutex_lock(&logFile_mutex);
+    lock_waited(&logLockStats, start);
+}
+
+void log_unlock() {
+    pthread_mutex_unlock(&logFile_mutex);
+}
+
+void users_rdlock() {
+    if (pthread_rwlock_tryrdlock(&userList_rwlock) == 0) {
+        return;
+    }
+    uint64_t start = trace_clock();
+    pthread_rwlock_rdlock(&userList_rwlock);
+    lock_waited(&userLockStats, start);
+}
+
+void users_wrlock() {
+    if (pthread_rwlock_trywrlock(&userList_rwlock) == 0) {
+        return;
+    }
+    uint64_t start = trace_clock();
+    pthread_rwlock_wrlock(&userList_rwlock);
+    lock_waited(&userLockStats, start);
+}
+
+void users_unlock() {
+    pthread_rwlock_unlock(&userList_rwlock);
+}
+
+int engine_init(const char * course_filename, const char * log_filename) {
+    // Initialize stats
+    curStats.clientCnt = 0;
+    curStats.threadCnt = 0;
+    curStats.totalAdds = 0;
+    curStats.totalDrops = 0;
+    atomic_init(&curStats.throttledReads, 0);
+    atomic_init(&curStats.throttledWrites, 0);
+    atomic_init(&curStats.shedRequests, 0);
+    atomic_init(&curStats.rejectedLogins, 0);
+    atomic_init(&curStats.reattached, 0);
+    atomic_init(&curStats.idleTimeouts, 0);
+    atomic_init(&curStats.reclaimed, 0);
+    pthread_mutex_init(&stats_mutex, NULL);
+
+    // Initialize user_t linked list
+    userList = CreateVector(user_comparator, NULL, NULL); //compare, print, delete
+    pthread_rwlock_init(&userList_rwlock, NULL);
+
+    // Priority groups first, course windows are relative to startup
+    load_groups(group_filename);
+    load_completed(completed_filename);
+    admission_init(sysconf(_SC_NPROCESSORS_ONLN));
+    ratelimit_init(read_rate, write_rate);
+    overload_init(max_clients, queue_depth, sysconf(_SC_NPROCESSORS_ONLN), delay_target_ms);
+
+    // Read in course to course array
+    course_file = course_filename;
+    int course_amt = read_courses(course_filename);
+    contested_init(course_amt);
+
+    // Open log file for writing
+    logFile = fopen(log_filename, "w");
+    if (!logFile) {
+        printf("ERROR: Could not open log file\n");
+        exit(2);
+    }
+    pthread_mutex_init(&logFile_mutex, NULL);
+
+    // Initialize courseArray mutexes
+    for (int i = 0; i < 32; ++i) {
+        pthread_mutex_init(&courseArray_mutexes[i].mutex, NULL);
+    }
+
+    if (trace_file != NULL) {
+        trace_init(trace_file, trace_sample);
+    }
+
+    // Seat holds expire from the timer wheel thread
+    if (hold_seconds > 0) {
+        timerwheel_start();
+    }
+
+    return course_amt;
+}
+
+//state of every course to stdout, every user and the counters to stderr
+void engine_dump() {
+    // Output the current state of all courses to STDOUT
+    catalog_t * cat = catalog_enter();
+    for (int i = 0; i < 32; ++i) {
+        course_lock(i);
+        if (i < cat->count) {
+            printf("%s, %d, %d, ", cat->courses[i].title, cat->courses[i].maxCap, courseArray[i].enrollment->length);
+            
+            // Output enrolled usernames in alphabetical order
+            for (int j = 0; j < courseArray[i].enrollment->length; ++j) {
+                printf("%s", (char *)VectorAt(courseArray[i].enrollment, j));
+                if (j + 1 < courseArray[i].enrollment->length) {
+                    printf(";");
+                }
+            }
+            
+            printf(", ");
+            
+            // Output waitlist usernames in waitlist order
+            for (int j = 0; j < courseArray[i].waitlist->length; ++j) {
+                printf("%s", (char *)VectorAt(courseArray[i].waitlist, j));
+                if (j + 1 < courseArray[i].waitlist->length) {
+                    printf(";");
+                }
+            }
+            
+            printf("\n");
+        }
+        course_unlock(i);
+    }
+    catalog_exit();
+
+    //output users to stderr
+    for (int i = 0; i < userList->length; ++i) {
+        user_t* user = VectorAt(userList, i);
+        fprintf(stderr, "%s, %u, %u\n", user->username, user->enrolled, user->waitlisted);
+    }
+
+    //curStats to stderr
+    fprintf(stderr, "%d, %d, %d, %d\n", curStats.clientCnt, curStats.threadCnt, curStats.totalAdds, curStats.totalDrops);
+}
+
+int user_comparator(const void * a, const void * b) {
+    const user_t * A = (const user_t *) a;
+    const user_t * B = (const user_t *) b;
+    return strcmp(A->username, B->username);
+}
+
+int read_courses (const char * file_name) {
+    char err[128];
+    catalog_t * cat = load_catalog(file_name, err, sizeof(err));
+    if (cat == NULL) {
+        printf("%s\n", err);
+        exit(2);
+    }
+
+    for (int index = 0; index < cat->count; ++index) {
+        courseArray[index].enrollment = CreateVector(user_comparator, NULL, NULL);
+        courseArray[index].waitlist = CreateVector(user_comparator, NULL, NULL);
+        courseArray[index].holds = CreateVector(NULL, NULL, NULL);
+    }
+    catalog_publish(cat);
+
+    return cat->count;
+}
+
+//must hold userList_rwlock
+user_t * find_user(const char * username) {
+    user_t key;
+    key.username = (char *)username;
+    int index = FindSorted(userList, &key);
+    return index < 0 ? NULL : VectorAt(userList, index);
+}
+
+//checked before taking the course lock. Returns why user may not add course index, or NULL
+const char * enroll_precheck(user_t * user, int index) {
+    course_info_t * course = &catalog_enter()->courses[index];
+    const char * denied = NULL;
+    if (window_clock() < course->open_at[user->group]) {
+        denied = "NOTOPEN";
+    } else if (course->prereqs & ~user->completed) {
+        denied = "PREREQ";
+    } else if (course->coreqs & ~(user->completed | user->enrolled)) {
+        denied = "COREQ";
+    } else if (course->conflicts & user->enrolled) {
+        denied = "CONFLICT";
+    }
+    catalog_exit();
+    return denied;
+}
+
+//must hold courseArray_mutexes[index]. Pops the first waitlisted user who can still take the course
+char * next_waitlisted(int index) {
+    while (courseArray[index].waitlist->length > 0) {
+        char * username = PopFront(courseArray[index].waitlist);
+        courseArray[index].waitHead++;
+
+        users_wrlock();
+        user_t * user = find_user(username);
+        int conflict = (catalog_enter()->courses[index].conflicts & user->enrolled) != 0;
+        catalog_exit();
+        if (conflict) {
+            user->waitlisted &= ~(1 << index);
+        }
+        users_unlock();
+
+        if (!conflict) {
+            return username;
+        }
+        log_lock();
+        fprintf(logFile, "%s NOWAITADD %d\n", username, index);
+        log_unlock();
+    }
+    return NULL;
+}
+
+//timer callback, the hold was not claimed in time
+void hold_expired(wheel_timer_t * timer) {
+    hold_t * hold = (hold_t *)timer;
+    int index = hold->course;
+
+    course_lock(index);
+    if (hold->state == HOLD_PENDING) {
+        SwapRemove(courseArray[index].holds, IndexOf(courseArray[index].holds, hold));
+
+        users_wrlock();
+        user_t * user = find_user(hold->username);
+        user->offered &= ~(1 << index);
+        users_unlock();
+
+        log_lock();
+        fprintf(logFile, "%s HOLDEXPIRE %d\n", hold->username, index);
+        log_unlock();
+
+        //seat goes to the next person in line
+        offer_seat(index, 0);
+        contested_update(index);
+    }
+    course_unlock(index);
+
+    fflush(logFile);
+    free(hold);
+}
+
+//must hold courseArray_mutexes[index]. Returns who the seat was offered to, or NULL. quiet leaves the OFFER log line to the caller
+char * offer_seat(int index, int quiet) {
+    char * username = next_waitlisted(index);
+    if (username == NULL) {
+        return NULL;
+    }
+
+    users_wrlock();
+    user_t * user = find_user(username);
+    user->waitlisted &= ~(1 << index);
+    user->offered |= (1 << index);
+    users_unlock();
+
+    hold_t * hold = malloc(sizeof(hold_t));
+    hold->timer.callback = hold_expired;
+    hold->username = username;
+    hold->course = index;
+    hold->state = HOLD_PENDING;
+    PushBack(courseArray[index].holds, hold);
+    timer_arm(&hold->timer, (uint64_t)hold_seconds * 1000);
+
+    if (!quiet) {
+        log_lock();
+        fprintf(logFile, "%s OFFER %d\n", username, index);
+        log_unlock();
+    }
+    return username;
+}
+
+//must hold courseArray_mutexes[index]. Returns 1 if user had a seat held and it is now theirs
+int claim_hold(int index, user_t * user) {
+    if (!(user->offered & (1 << index))) {
+        return 0;
+    }
+
+    hold_t * hold = NULL;
+    for (int i = 0; i < courseArray[index].holds->length; ++i) {
+        hold_t * temp = VectorAt(courseArray[index].holds, i);
+        if (strcmp(temp->username, user->username) == 0) {
+            hold = SwapRemove(courseArray[index].holds, i);
+            break;
+        }
+    }
+    if (hold == NULL) {
+        return 0;
+    }
+
+    users_wrlock();
+    user->offered &= ~(1 << index);
+    users_unlock();
+
+    //if the timer already fired, its callback frees the hold
+    hold->state = HOLD_CLAIMED;
+    if (timer_cancel(&hold->timer)) {
+        free(hold);
+    }
+    return 1;
+}
+
+//must hold courseArray_mutexes[index]. Gives one free seat to the waitlist, returns who got it or NULL. quiet leaves the WAITADD/OFFER log line to the caller
+char * fill_seat(int index, int quiet) {
+    if (hold_seconds > 0) {
+        return offer_seat(index, quiet);
+    }
+
+    char * add_from_wait_username = next_waitlisted(index);
+    if (add_from_wait_username == NULL) {
+        return NULL;
+    }
+    users_rdlock();
+    user_t* nextUser = find_user(add_from_wait_username);
+    users_unlock();
+    PushBack(courseArray[index].enrollment, add_from_wait_username);
+    nextUser->enrolled |= (1 << index);
+    nextUser->waitlisted &= ~(1 << index);
+
+    //fix to make sure bitvector is set
+    users_wrlock();
+    user_t * temp_user = find_user(nextUser->username);
+    temp_user->enrolled |= (1 << index);
+    temp_user->waitlisted &= ~(1 << index);
+    users_unlock();
+
+    pthread_mutex_lock(&stats_mutex);
+    curStats.totalAdds++;
+    pthread_mutex_unlock(&stats_mutex);
+
+    if (!quiet) {
+        log_lock();
+        fprintf(logFile, "%s WAITADD %d %d\n", add_from_wait_username, index, nextUser->enrolled);
+        log_unlock();
+    }
+    return add_from_wait_username;
+}
+
+/*
+ * Re-read the course file and publish it as the new catalog. Rosters stay
+ * with their course index, so existing courses have to keep their index
+ * and title; new courses may be appended. Courses with room to spare
+ * afterwards take students off their waitlist.
+ *
+ * Must not be called with the catalog pinned. Returns -1 if the file was
+ * rejected and the old catalog stays.
+ */
+int reload_courses(const char * username) {
+    pthread_mutex_lock(&reload_mutex);
+    char err[128];
+    catalog_t * next = load_catalog(course_file, err, sizeof(err));
+    if (next == NULL) {
+        printf("%s\n", err);
+        pthread_mutex_unlock(&reload_mutex);
+        return -1;
+    }
+
+    catalog_t * cat = catalog_enter();
+    int old_count = cat->count;
+    int compatible = next->count >= old_count;
+    for (int i = 0; compatible && i < old_count; ++i) {
+        compatible = strcmp(next->courses[i].title, cat->courses[i].title) == 0;
+    }
+    catalog_exit();
+    if (!compatible) {
+        printf("ERROR: Reloaded course file has to keep every course at its index\n");
+        for (int i = 0; i < next->count; ++i) {
+            free(next->courses[i].title);
+            free(next->courses[i].meets);
+        }
+        free(next);
+        pthread_mutex_unlock(&reload_mutex);
+        return -1;
+    }
+
+    //rosters for the new courses exist before anyone can see them
+    for (int index = old_count; index < next->count; ++index) {
+        courseArray[index].enrollment = CreateVector(user_comparator, NULL, NULL);
+        courseArray[index].waitlist = CreateVector(user_comparator, NULL, NULL);
+        courseArray[index].holds = CreateVector(NULL, NULL, NULL);
+    }
+    int count = next->count;
+    catalog_publish(next);
+    contested_grow(count);
+
+    log_lock();
+    fprintf(logFile, "%s RELOAD %d\n", username, count);
+    log_unlock();
+
+    //raised capacities go to the waitlist right away
+    cat = catalog_enter();
+    for (int index = 0; index < count; ++index) {
+        course_lock(index);
+        while (courseArray[index].enrollment->length + courseArray[index].holds->length < cat->courses[index].maxCap &&
+               fill_seat(index, 0) != NULL) {
+        }
+        contested_update(index);
+        course_unlock(index);
+    }
+    catalog_exit();
+    fflush(logFile);
+
+    pthread_mutex_unlock(&reload_mutex);
+    return 0;
+}
+
+//whether username is in the comma separated admin_list
+static int lookup_admin(const char * username) {
+    size_t len = strlen(username);
+    const char * p = admin_list;
+    while (p != NULL && *p != '\0') {
+        const char * end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if (n == len && strncmp(p, username, n) == 0) {
+            return 1;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return 0;
+}
+
+//check username against userList, creating the user on first login. NULL if the user store is full
+user_t * login_user(int client_fd, const char * username) {
+    users_wrlock();
+    user_t * user = find_user(username);
+
+    //handle found or not found user
+    if (user == NULL) {
+        user = user_new(username);
+        if (user == NULL) {
+            users_unlock();
+            return NULL;
+        }
+        user_cold(user)->socket_fd = client_fd;
+        user->group = lookup_group(user->username);
+        user->completed = lookup_completed(user->username);
+        user_cold(user)->admin = lookup_admin(user->username);
+        InsertSorted(userList, user);
+
+        log_lock();
+        fprintf(logFile, "CONNECTED %s\n", user->username);
+        log_unlock();
+    } else{
+        user_cold(user)->socket_fd = client_fd;
+
+        log_lock();
+        fprintf(logFile, "RECONNECTED %s\n", user->username);
+        log_unlock();
+    }
+    users_unlock();
+
+    return user;
+}
+
+//what users and rosters cost, for STATS. Takes the user list and course locks one at a time
+void memory_report(char * buf, size_t len) {
+    int users = 0, slots = 0;
+    size_t heapBytes = 0;
+    users_rdlock();
+    size_t userBytes = userstore_bytes(&users, &slots, &heapBytes) + userList->capacity * sizeof(void *);
+    users_unlock();
+
+    //roster slots point at the user's name, a hold also carries its timer
+    int entries = 0, rosterSlots = 0;
+    size_t rosterBytes = 0;
+    catalog_t * cat = catalog_enter();
+    for (int i = 0; i < cat->count; ++i) {
+        course_lock(i);
+        entries += courseArray[i].enrollment->length + courseArray[i].waitlist->length + courseArray[i].holds->length;
+        rosterSlots += courseArray[i].enrollment->capacity + courseArray[i].waitlist->capacity +
+                       courseArray[i].holds->capacity;
+        rosterBytes += 3 * sizeof(vector_t) + (courseArray[i].enrollment->capacity + courseArray[i].waitlist->capacity +
+                       courseArray[i].holds->capacity) * sizeof(void *) + courseArray[i].holds->length * sizeof(hold_t);
+        course_unlock(i);
+    }
+    catalog_exit();
+
+    //users and rosters grow a block of slots at a time, so report what a slot costs rather than dividing by entries
+    snprintf(buf, len, "users %d in %d slots, %zu B (%zu B/slot, %zu B names and wait tables), "
+             "roster entries %d in %d slots, %zu B (%zu B/slot, %zu B/hold), session %zu B\n",
+             users, slots, userBytes, sizeof(user_t) + sizeof(user_cold_t), heapBytes, entries, rosterSlots,
+             rosterBytes, sizeof(void *), sizeof(hold_t), sizeof(session_t));
+}
+
+//login turned away because the server is full
+void reject_login(const char * username) {
+    log_lock();
+    fprintf(logFile, "REJECTED %s\n", username);
+    log_unlock();
+    fflush(logFile);
+
+    atomic_fetch_add(&curStats.rejectedLogins, 1);
+}
+
+//span name of a request type
+const char * request_name(uint8_t type) {
+    switch (type) {
+    case LOGIN: return "LOGIN";
+    case LOGOUT: return "LOGOUT";
+    case CLIST: return "CLIST";
+    case SCHED: return "SCHED";
+    case ENROLL: return "ENROLL";
+    case DROP: return "DROP";
+    case WAIT: return "WAIT";
+    case CONTESTED: return "CONTESTED";
+    case STATS: return "STATS";
+    case RELOAD: return "RELOAD";
+    case SWAP: return "SWAP";
+    case WAITPOS: return "WAITPOS";
+    default: return "UNKNOWN";
+    }
+}
+
+//Handle one request of a logged in session. Returns 1 once the session logged out
+int handle_request(session_t * session, petrV_header * request, char * body){
+    petrV_header header = *request;
+
+    //per session budgets, pollers get ESERV before any lock is taken
+    int kind = -1;
+    if (header.msg_type == CLIST || header.msg_type == SCHED || header.msg_type == CONTESTED ||
+        header.msg_type == STATS || header.msg_type == WAITPOS) {
+        kind = RATE_READ;
+    } else if (header.msg_type == ENROLL || header.msg_type == WAIT || header.msg_type == DROP ||
+               header.msg_type == SWAP) {
+        kind = RATE_WRITE;
+    }
+    int retry_ms = 0;
+    if (kind >= 0 && (retry_ms = ratelimit_take(&session->buckets[kind], kind, overload_clock())) != 0) {
+        session_busy(session, &header, retry_ms);
+        atomic_fetch_add(kind == RATE_READ ? &curStats.throttledReads : &curStats.throttledWrites, 1);
+        return 0;
+    }
+
+    //admin requests, anyone not listed with -a is refused before they touch a lock
+    if ((header.msg_type == RELOAD || header.msg_type == CONTESTED || header.msg_type == STATS) &&
+        !user_cold(session->user)->admin) {
+        uint8_t type = header.msg_type;
+        header.msg_type = ECDENIED;
+        header.msg_len = 0;
+        session_reply(session, &header, "");
+
+        log_lock();
+        fprintf(logFile, "%s NO%s\n", session->local.username, request_name(type));
+        log_unlock();
+        fflush(logFile);
+        return 0;
+    }
+
+    //admin, swaps the catalog so it runs before this request pins one
+    if (header.msg_type == RELOAD) {
+        header.msg_len = 0;
+        if (reload_courses(session->local.username) == 0) {
+            header.msg_type = OK;
+        } else {
+            header.msg_type = ECDENIED;
+
+            log_lock();
+            fprintf(logFile, "%s NORELOAD\n", session->local.username);
+            log_unlock();
+            fflush(logFile);
+        }
+        session_reply(session, &header, "");
+        return 0;
+    }
+
+    //the catalog this request sees, even if a reload publishes another meanwhile
+    catalog_t * cat = catalog_enter();
+
+    switch (header.msg_type) {
+    case LOGOUT:
+    {
+        header.msg_type = OK;
+        header.msg_len = 0;
+        session_reply(session, &header, "");
+
+        log_lock();
+        fprintf(logFile, "%s LOGOUT\n", session->local.username);
+        log_unlock();
+
+        fflush(logFile);
+        catalog_exit();
+        return 1;
+    }
+    case CLIST: //list courses on the server
+    {
+        char response_text[BUFFER_SIZE] = {0};
+        for (int i = 0; i < 32; ++i) {
+            course_lock(i);
+            if (i < cat->count) {
+                
+                char course_info[128];
+                if (courseArray[i].enrollment->length + courseArray[i].holds->length >= cat->courses[i].maxCap) {
+                    snprintf(course_info, sizeof(course_info), "Course %d - %s (CLOSED)\n", i, cat->courses[i].title);
+                } else {
+                    snprintf(course_info, sizeof(course_info), "Course %d - %s\n", i, cat->courses[i].title);
+                }
+                strncat(response_text, course_info, sizeof(response_text) - strlen(response_text) - 1);
+                
+            }
+            course_unlock(i);
+        }
+        header.msg_len = strlen(response_text);
+        header.msg_type = CLIST;
+        session_reply(session, &header, response_text);
+
+        log_lock();
+        fprintf(logFile, "%s CLIST\n", session->local.username);
+        log_unlock();
+
+        fflush(logFile);
+        break;
+    }
+    case SCHED:
+    {
+        //the session points at the shared user, no lookup. Its bitmaps are read unlocked as before
+        user_t * user = session->user;
+        uint32_t enrolled = user->enrolled;
+        uint32_t waitlisted = user->waitlisted;
+        uint32_t offered = user->offered;
+
+        //a held seat is listed too, it is only the student's once they ENROLL into it
+        if (!(enrolled | waitlisted | offered)) {
+            header.msg_len = 0;
+            header.msg_type = ENOCOURSES;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NOSCHED\n", session->local.username);
+            log_unlock();
+        } else {
+            //rebuild only once ENROLL, WAIT, DROP, SWAP, a promotion or an offer changed what it shows
+            if (session->sched == NULL || enrolled != session->schedEnrolled ||
+                waitlisted != session->schedWaitlisted || offered != session->schedOffered) {
+                uint64_t t = trace_start();
+                char response_txt[BUFFER_SIZE];
+                size_t len = 0;
+                for (uint32_t left = enrolled | waitlisted | offered; left != 0; left &= left - 1) {
+                    int i = __builtin_ctz(left);
+                    const char * note = (offered & (1u << i)) ? " (HELD)" : (waitlisted & (1u << i)) ? " (WAITING)" : "";
+                    int n = snprintf(response_txt + len, sizeof(response_txt) - len, "Course %d - %s%s\n", i,
+                                     cat->courses[i].title, note);
+                    len += n > 0 ? n : 0;
+                    if (len >= sizeof(response_txt)) {
+                        len = sizeof(response_txt) - 1;
+                    }
+                }
+                session->sched = realloc(session->sched, len);
+                memcpy(session->sched, response_txt, len);
+                session->schedLen = len;
+                session->schedEnrolled = enrolled;
+                session->schedWaitlisted = waitlisted;
+                session->schedOffered = offered;
+                trace_end("schedule build", t);
+            }
+
+            header.msg_len = session->schedLen;
+            header.msg_type = SCHED;
+            session_reply(session, &header, session->sched);
+
+            log_lock();
+            fprintf(logFile, "%s SCHED\n", session->local.username);
+            log_unlock();
+        }
+
+        fflush(logFile);
+        break;
+    }
+        
+    case ENROLL:
+    {
+        int index = atoi(body);
+        if (index < 0 || index >= cat->count) {
+            header.msg_type = ECNOTFOUND;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NOTFOUND_E %d\n", session->local.username, index);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+
+        const char * denied = enroll_precheck(session->user, index);
+        if (denied != NULL) {
+            header.msg_type = ECDENIED;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s %s_E %d\n", session->local.username, denied, index);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+
+        uint64_t t = trace_start();
+        int shed = admission_enter(session->arrived);
+        trace_end("admission", t);
+        if (shed != 0) {
+            session_busy(session, &header, overload_retry_after());
+            atomic_fetch_add(&curStats.shedRequests, 1);
+
+            log_lock();
+            fprintf(logFile, "%s BUSY_E %d\n", session->local.username, index);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+        t = trace_start();
+        course_lock(index);
+        trace_end("course lock", t);
+
+        if (session->local.enrolled & (1 << index) ||
+            (!claim_hold(index, session->user) &&
+             courseArray[index].enrollment->length + courseArray[index].holds->length >= cat->courses[index].maxCap)) {
+            header.msg_type = ECDENIED;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+            fprintf(logFile, "%s NOENROLL %d\n", session->local.username, index);
+        } else {
+            //insert into class list and mark as enrolled in user_t
+            t = trace_start();
+            PushBack(courseArray[index].enrollment, session->local.username);
+            session->local.enrolled |= (1 << index);
+            contested_update(index);
+
+            //fix to make sure bitvector is set
+            users_wrlock();
+            find_user(session->local.username)->enrolled |= (1 << index);
+            users_unlock();
+            trace_end("roster update", t);
+
+            //return response
+            header.msg_type = OK;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            //write to log
+            t = trace_start();
+            log_lock();
+            fprintf(logFile, "%s ENROLL %d %d\n", session->local.username, index, session->local.enrolled);
+            log_unlock();
+            trace_end("log write", t);
+        }
+        course_unlock(index);
+        admission_exit();
+
+        //curStats upddate
+        pthread_mutex_lock(&stats_mutex);
+        curStats.totalAdds++;
+        pthread_mutex_unlock(&stats_mutex);
+
+        t = trace_start();
+        fflush(logFile);
+        trace_end("log flush", t);
+        break;
+    }
+    case WAIT:
+    {
+        int index = atoi(body);
+        if (index < 0 || index >= cat->count) {
+            header.msg_type = ECNOTFOUND;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NOTFOUND_W %d\n", session->local.username, index);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+
+        const char * denied = enroll_precheck(session->user, index);
+        if (denied != NULL) {
+            header.msg_type = ECDENIED;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s %s_W %d\n", session->local.username, denied, index);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+
+        uint64_t t = trace_start();
+        int shed = admission_enter(session->arrived);
+        trace_end("admission", t);
+        if (shed != 0) {
+            session_busy(session, &header, overload_retry_after());
+            atomic_fetch_add(&curStats.shedRequests, 1);
+
+            log_lock();
+            fprintf(logFile, "%s BUSY_W %d\n", session->local.username, index);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+        t = trace_start();
+        course_lock(index);
+        trace_end("course lock", t);
+
+        if (courseArray[index].enrollment->length + courseArray[index].holds->length < cat->courses[index].maxCap || (session->local.enrolled & (1 << index))) {
+            header.msg_type = ECDENIED;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NOWAIT %d\n", session->local.username, index);
+            log_unlock();
+        } else {
+            //insert into waitlist and mark as waitlisted in user_t
+            t = trace_start();
+            PushBack(courseArray[index].waitlist, session->local.username);
+            session->local.waitlisted |= (1 << index);
+            contested_update(index);
+
+            //fix to make sure bitvector is set, the sequence number stays with the user's first entry
+            uint32_t seq = courseArray[index].waitTail++;
+            users_wrlock();
+            user_t * shared = find_user(session->local.username);
+            if (!(shared->waitlisted & (1 << index))) {
+                user_set_wait_seq(shared, index, seq);
+            }
+            shared->waitlisted |= (1 << index);
+            users_unlock();
+            trace_end("roster update", t);
+
+            //return response
+            header.msg_type = OK;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            //write to log
+            t = trace_start();
+            log_lock();
+            fprintf(logFile, "%s WAIT %d %d\n", session->local.username, index, session->local.waitlisted);
+            log_unlock();
+            trace_end("log write", t);
+        }
+        course_unlock(index);
+        admission_exit();
+        t = trace_start();
+        fflush(logFile);
+        trace_end("log flush", t);
+        break;
+    }
+    
+    case DROP:
+    {
+        int index = atoi(body);
+        if (index < 0 || index >= cat->count) {
+            header.msg_type = ECNOTFOUND;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NOTFOUND_D %d\n", session->local.username, index);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+
+        uint64_t t = trace_start();
+        int shed = admission_enter(session->arrived);
+        trace_end("admission", t);
+        if (shed != 0) {
+            session_busy(session, &header, overload_retry_after());
+            atomic_fetch_add(&curStats.shedRequests, 1);
+
+            log_lock();
+            fprintf(logFile, "%s BUSY_D %d\n", session->local.username, index);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+        t = trace_start();
+        course_lock(index);
+        trace_end("course lock", t);
+
+        if (!(session->local.enrolled & (1 << index))) {
+            header.msg_type = ECDENIED;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NODROP %d\n", session->local.username, index);
+            log_unlock();
+        } else {
+            //search for and remove username from course list
+            t = trace_start();
+            vector_t * enrollment = courseArray[index].enrollment;
+            for (int i = 0; i < enrollment->length; ++i) {
+                if (strcmp((char *)VectorAt(enrollment, i), session->local.username) == 0) {
+                    RemoveAt(enrollment, i);
+                    break;
+                }
+            }
+            session->local.enrolled &= ~(1 << index);
+
+            //fix to make sure bitvector is set
+            users_wrlock();
+            find_user(session->local.username)->enrolled &= ~(1 << index);
+            users_unlock();
+            trace_end("roster update", t);
+
+            //stats
+            pthread_mutex_lock(&stats_mutex);
+            curStats.totalDrops++;
+            pthread_mutex_unlock(&stats_mutex);
+
+            //respond to client
+            header.msg_type = OK;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            //log
+            t = trace_start();
+            log_lock();
+            fprintf(logFile, "%s DROP %d %d\n", session->local.username, index, session->local.enrolled);
+            log_unlock();
+            trace_end("log write", t);
+
+            //waitlist post drop logic
+            t = trace_start();
+            fill_seat(index, 0);
+            contested_update(index);
+            trace_end("waitlist promotion", t);
+        }
+
+        course_unlock(index);
+        admission_exit();
+        t = trace_start();
+        fflush(logFile);
+        trace_end("log flush", t);
+        break;
+    }
+
+    case SWAP: //drop one course and enroll in another, all or nothing
+    {
+        int from = -1, to = -1;
+        sscanf(body, "%d,%d", &from, &to);
+        if (from < 0 || from >= cat->count || to < 0 || to >= cat->count) {
+            header.msg_type = ECNOTFOUND;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NOTFOUND_S %d %d\n", session->local.username, from, to);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+
+        //requirements are checked as if from was already dropped, so a section can replace one it overlaps
+        user_t probe = *session->user;
+        probe.enrolled &= ~(1 << from);
+        const char * denied = NULL;
+        if (from != to && (denied = enroll_precheck(&probe, to)) != NULL) {
+            header.msg_type = ECDENIED;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s %s_S %d %d\n", session->local.username, denied, from, to);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+
+        uint64_t t = trace_start();
+        int shed = admission_enter(session->arrived);
+        trace_end("admission", t);
+        if (shed != 0) {
+            session_busy(session, &header, overload_retry_after());
+            atomic_fetch_add(&curStats.shedRequests, 1);
+
+            log_lock();
+            fprintf(logFile, "%s BUSY_S %d %d\n", session->local.username, from, to);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+
+        //lower index first, two swaps going opposite ways cannot deadlock
+        int first = from < to ? from : to;
+        int second = from < to ? to : from;
+        t = trace_start();
+        course_lock(first);
+        if (second != first) {
+            course_lock(second);
+        }
+        trace_end("course lock", t);
+
+        if (from == to || !(session->local.enrolled & (1 << from)) || (session->local.enrolled & (1 << to)) ||
+            (!claim_hold(to, session->user) &&
+             courseArray[to].enrollment->length + courseArray[to].holds->length >= cat->courses[to].maxCap)) {
+            header.msg_type = ECDENIED;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NOSWAP %d %d\n", session->local.username, from, to);
+            log_unlock();
+        } else {
+            //move the seat, nobody holding either lock can see the user in both or neither
+            t = trace_start();
+            vector_t * enrollment = courseArray[from].enrollment;
+            for (int i = 0; i < enrollment->length; ++i) {
+                if (strcmp((char *)VectorAt(enrollment, i), session->local.username) == 0) {
+                    RemoveAt(enrollment, i);
+                    break;
+                }
+            }
+            PushBack(courseArray[to].enrollment, session->local.username);
+            session->local.enrolled = (session->local.enrolled & ~(1 << from)) | (1 << to);
+
+            users_wrlock();
+            user_t * shared = find_user(session->local.username);
+            shared->enrolled = (shared->enrolled & ~(1 << from)) | (1 << to);
+            users_unlock();
+
+            //the freed seat goes to the waitlist before either course is unlocked
+            char * promoted = fill_seat(from, 1);
+            int promoted_enrolled = 0;
+            if (promoted != NULL) {
+                users_rdlock();
+                promoted_enrolled = find_user(promoted)->enrolled;
+                users_unlock();
+            }
+            contested_update(from);
+            contested_update(to);
+            trace_end("roster update", t);
+
+            pthread_mutex_lock(&stats_mutex);
+            curStats.totalAdds++;
+            curStats.totalDrops++;
+            pthread_mutex_unlock(&stats_mutex);
+
+            header.msg_type = OK;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            //one record for the drop, the enroll and the promotion
+            t = trace_start();
+            log_lock();
+            fprintf(logFile, "%s SWAP %d %d %d", session->local.username, from, to, session->local.enrolled);
+            if (promoted != NULL && hold_seconds > 0) {
+                fprintf(logFile, " OFFER %s", promoted);
+            } else if (promoted != NULL) {
+                fprintf(logFile, " WAITADD %s %d", promoted, promoted_enrolled);
+            }
+            fprintf(logFile, "\n");
+            log_unlock();
+            trace_end("log write", t);
+        }
+
+        if (second != first) {
+            course_unlock(second);
+        }
+        course_unlock(first);
+        admission_exit();
+        t = trace_start();
+        fflush(logFile);
+        trace_end("log flush", t);
+        break;
+    }
+
+    case WAITPOS: //place in a waitlist
+    {
+        int index = atoi(body);
+        if (index < 0 || index >= cat->count) {
+            header.msg_type = ECNOTFOUND;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NOTFOUND_P %d\n", session->local.username, index);
+            log_unlock();
+            fflush(logFile);
+            break;
+        }
+
+        //entries only ever leave from the front, so the place is the distance to the head's sequence number
+        int rank = 0;
+        int held = 0;
+        course_lock(index);
+        int length = courseArray[index].waitlist->length;
+        users_rdlock();
+        held = (session->user->offered & (1 << index)) != 0;
+        if (session->user->waitlisted & (1 << index)) {
+            rank = ((user_wait_seq(session->user, index) - courseArray[index].waitHead) & WAIT_SEQ_MASK) + 1;
+        }
+        users_unlock();
+        course_unlock(index);
+
+        if (held) {
+            //off the waitlist already, the seat is theirs if they ENROLL before the hold runs out
+            char response_text[128];
+            snprintf(response_text, sizeof(response_text), "Course %d - %s (HELD, ENROLL to take the seat)\n",
+                     index, cat->courses[index].title);
+            header.msg_type = WAITPOS;
+            header.msg_len = strlen(response_text);
+            session_reply(session, &header, response_text);
+
+            log_lock();
+            fprintf(logFile, "%s WAITPOS %d 0\n", session->local.username, index);
+            log_unlock();
+        } else if (rank == 0) {
+            header.msg_type = ECDENIED;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+
+            log_lock();
+            fprintf(logFile, "%s NOWAITPOS %d\n", session->local.username, index);
+            log_unlock();
+        } else {
+            char response_text[128];
+            snprintf(response_text, sizeof(response_text), "Course %d - %s (%d of %d waiting)\n",
+                     index, cat->courses[index].title, rank, length);
+            header.msg_type = WAITPOS;
+            header.msg_len = strlen(response_text);
+            session_reply(session, &header, response_text);
+
+            log_lock();
+            fprintf(logFile, "%s WAITPOS %d %d\n", session->local.username, index, rank);
+            log_unlock();
+        }
+
+        fflush(logFile);
+        break;
+    }
+
+    case CONTESTED: //admin query, most contested courses first
+    {
+        int k = header.msg_len > 0 ? atoi(body) : 0;
+        if (k <= 0 || k > 32) {
+            k = CONTESTED_DEFAULT_K;
+        }
+
+        int top[32];
+        contested_key_t keys[32];
+        int n = contested_top(k, cat->count, top, keys);
+
+        char response_text[BUFFER_SIZE] = {0};
+        for (int i = 0; i < n; ++i) {
+            char course_info[128];
+            snprintf(course_info, sizeof(course_info), "Course %d - %s (%d/%d, %d waiting)\n", top[i],
+                     cat->courses[top[i]].title, keys[i].enrolled, keys[i].maxCap, keys[i].waiting);
+            strncat(response_text, course_info, sizeof(response_text) - strlen(response_text) - 1);
+        }
+
+        if (n == 0) {
+            header.msg_type = ENOCOURSES;
+            header.msg_len = 0;
+            session_reply(session, &header, "");
+        } else {
+            header.msg_type = CONTESTED;
+            header.msg_len = strlen(response_text);
+            session_reply(session, &header, response_text);
+        }
+
+        log_lock();
+        fprintf(logFile, "%s CONTESTED %d\n", session->local.username, k);
+        log_unlock();
+
+        fflush(logFile);
+        break;
+    }
+        
+    case STATS: //admin query, server counters
+    {
+        char response_text[BUFFER_SIZE];
+        pthread_mutex_lock(&stats_mutex);
+        snprintf(response_text, sizeof(response_text),
+                 "clients %d, threads %d, adds %d, drops %d\n"
+                 "throttled reads %d, throttled writes %d, shed %d, rejected logins %d\n"
+                 "reattached %d, idle timeouts %d, reclaimed threads %d\n",
+                 curStats.clientCnt, curStats.threadCnt, curStats.totalAdds, curStats.totalDrops,
+                 atomic_load(&curStats.throttledReads), atomic_load(&curStats.throttledWrites),
+                 atomic_load(&curStats.shedRequests), atomic_load(&curStats.rejectedLogins),
+                 atomic_load(&curStats.reattached), atomic_load(&curStats.idleTimeouts),
+                 atomic_load(&curStats.reclaimed));
+        pthread_mutex_unlock(&stats_mutex);
+        memory_report(response_text + strlen(response_text), sizeof(response_text) - strlen(response_text));
+        snprintf(response_text + strlen(response_text), sizeof(response_text) - strlen(response_text),
+                 "lock waits: courses %ld (%ld us), log %ld (%ld us), users %ld (%ld us)\n",
+                 atomic_load(&courseLockStats.contended), atomic_load(&courseLockStats.waitNs) / 1000,
+                 atomic_load(&logLockStats.contended), atomic_load(&logLockStats.waitNs) / 1000,
+                 atomic_load(&userLockStats.contended), atomic_load(&userLockStats.waitNs) / 1000);
+
+        header.msg_type = STATS;
+        header.msg_len = strlen(response_text);
+        session_reply(session, &header, response_text);
+
+        log_lock();
+        fprintf(logFile, "%s STATS\n", session->local.username);
+        log_unlock();
+
+        fflush(logFile);
+        break;
+    }
+
+    default:
+        break;
+    }
+    catalog_exit();
+    return 0;
+}
+
+void session_init(session_t * session, user_t * user, int fd) {
+    session->local = *user;
+    session->user = user;
+    session->fd = fd;
+    session->out = NULL;
+    session->outLen = 0;
+    session->outCap = 0;
+    session->arrived = 0;
+    memset(session->buckets, 0, sizeof(session->buckets));
+    session->sched = NULL;
+    session->schedLen = 0;
+}
+
+void session_release(session_t * session) {
+    free(session->out);
+    free(session->sched);
+    session->out = NULL;
+    session->sched = NULL;
+}
+
+//queued for the transport to send
+void session_reply(session_t * session, petrV_header * h, char * msgbuf) {
+    // same bytes wr_msg would send: the header followed by msg_len bytes of body
+    size_t need = session->outLen + sizeof(petrV_header) + h->msg_len;
+    if (need > session->outCap) {
+        session->outCap = need > 2 * session->outCap ? need : 2 * session->outCap;
+        session->out = realloc(session->out, session->outCap);
+    }
+    memcpy(session->out + session->outLen, h, sizeof(petrV_header));
+    memcpy(session->out + session->outLen + sizeof(petrV_header), msgbuf, h->msg_len);
+    session->outLen = need;
+}
+
+//ESERV, telling the client how many ms to wait before trying again
+void session_busy(session_t * session, petrV_header * h, int retry_ms) {
+    char retry[16];
+    snprintf(retry, sizeof(retry), "%d", retry_ms);
+    h->msg_type = ESERV;
+    h->msg_len = strlen(retry);
+    session_reply(session, h, retry);
+}
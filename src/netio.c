@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+#include "netio.h"
+#include <errno.h>
+#include <netinet/tcp.h>
+#include <sched.h>
+
+static int pinCpus[CPU_SETSIZE];   // the -P list, in order
+static int pinCount = 0;
+static atomic_uint nextSlot = 0;
+
+int pin_parse(const char * list) {
+    pinCount = 0;
+    const char * p = list;
+    while (*p != '\0') {
+        char * end;
+        long lo = strtol(p, &end, 10);
+        long hi = lo;
+        if (end == p) {
+            return -1;
+        }
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p) {
+                return -1;
+            }
+        }
+        if (lo < 0 || hi < lo || hi >= CPU_SETSIZE) {
+            return -1;
+        }
+        for (long cpu = lo; cpu <= hi && pinCount < CPU_SETSIZE; ++cpu) {
+            pinCpus[pinCount++] = cpu;
+        }
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return -1;
+        }
+        p = end;
+    }
+    return pinCount;
+}
+
+int pin_count() {
+    return pinCount;
+}
+
+int pin_thread(int slot) {
+    if (pinCount == 0) {
+        return -1;
+    }
+    int cpu = pinCpus[slot % pinCount];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        return -1;
+    }
+    return cpu;
+}
+
+int pin_slot(int fd) {
+    if (pinCount == 0) {
+        return 0;
+    }
+    int cpu;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0) {
+        for (int i = 0; i < pinCount; ++i) {
+            if (pinCpus[i] == cpu) {
+                return i;
+            }
+        }
+    }
+    return atomic_fetch_add(&nextSlot, 1) % pinCount;
+}
+
+int listener_clone(int listen_fd, int cpu) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int opt = 1;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0 || getsockname(listen_fd, (SA*)&addr, &len) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) != 0 ||
+        bind(fd, (SA*)&addr, len) != 0 || listen(fd, SOMAXCONN) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+void socket_keepalive(int fd) {
+    int on = 1, idle = KEEPALIVE_IDLE, interval = KEEPALIVE_INTERVAL, count = KEEPALIVE_COUNT;
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+}
+
+//blocking backend, write out what the engine queued and drop the buffer
+void session_send(session_t * session) {
+    uint64_t t = trace_start();
+    size_t sent = 0;
+    while (sent < session->outLen) {
+        ssize_t n = send(session->fd, session->out + sent, session->outLen - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+    free(session->out);
+    session->out = NULL;
+    session->outLen = 0;
+    session->outCap = 0;
+    trace_end("reply write", t);
+}
+
+
+conn_t * conn_new(int fd) {
+    conn_t * conn = calloc(1, sizeof(conn_t));
+    conn->session.fd = fd;
+    conn->state = CONN_HEADER;
+    return conn;
+}
+
+void conn_free(conn_t * conn) {
+    if (conn->loggedIn) {
+        overload_disconnect();
+    }
+    session_release(&conn->session);
+    free(conn->body);
+    free(conn);
+}
+
+//first message of a connection, has to be LOGIN
+static int conn_login(conn_t * conn, petrV_header * header, char * username) {
+    if (header->msg_type != LOGIN) {
+        return -1;
+    }
+    if (overload_connect() != 0) {
+        reject_login(username);
+        session_busy(&conn->session, header, overload_retry_after());
+        return -1;
+    }
+
+    user_t * user = login_user(conn->session.fd, username);
+    if (user == NULL) {
+        overload_disconnect();
+        reject_login(username);
+        session_busy(&conn->session, header, overload_retry_after());
+        return -1;
+    }
+    session_init(&conn->session, user, conn->session.fd);
+    conn->loggedIn = 1;
+
+    header->msg_len = 0;
+    header->msg_type = OK;
+    session_reply(&conn->session, header, "OK");
+
+    pthread_mutex_lock(&stats_mutex);
+    curStats.clientCnt++;
+    pthread_mutex_unlock(&stats_mutex);
+
+    fflush(logFile);
+    return 0;
+}
+
+int conn_input(conn_t * conn, const char * data, size_t len) {
+    while (!conn->closing) {
+        if (conn->state == CONN_HEADER) {
+            size_t n = sizeof(petrV_header) - conn->got;
+            n = n < len ? n : len;
+            memcpy((char *)&conn->header + conn->got, data, n);
+            conn->got += n;
+            data += n;
+            len -= n;
+            if (conn->got < sizeof(petrV_header)) {
+                return 0;
+            }
+            //no request comes close to BUFFER_SIZE, a longer one is garbage and is not buffered
+            if (conn->header.msg_len > BUFFER_SIZE) {
+                conn->closing = 1;
+                return -1;
+            }
+            conn->body = malloc((size_t)conn->header.msg_len + 1);
+            if (conn->body == NULL) {
+                conn->closing = 1;
+                return -1;
+            }
+            conn->got = 0;
+            conn->state = CONN_BODY;
+        }
+
+        size_t n = conn->header.msg_len - conn->got;
+        n = n < len ? n : len;
+        memcpy(conn->body + conn->got, data, n);
+        conn->got += n;
+        data += n;
+        len -= n;
+        if (conn->got < conn->header.msg_len) {
+            return 0;
+        }
+        conn->body[conn->header.msg_len] = '\0';
+
+        //event loops read whole batches, so a request's spans start once it is complete
+        trace_request();
+        uint64_t t = trace_start();
+        uint8_t type = conn->header.msg_type;
+        int rc;
+        if (!conn->loggedIn) {
+            rc = conn_login(conn, &conn->header, conn->body);
+        } else {
+            rc = handle_request(&conn->session, &conn->header, conn->body);
+        }
+        trace_end_detail(request_name(type), conn->loggedIn ? conn->session.local.username : conn->body, t);
+        free(conn->body);
+        conn->body = NULL;
+        conn->got = 0;
+        conn->state = CONN_HEADER;
+        if (rc != 0) {
+            conn->closing = 1;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,279 @@
+#include "netio.h"
+#include <errno.h>
+#include <time.h>
+
+/*
+    Thread per client backend. A client_t belongs to a user, not to a
+    connection: when its connection ends the thread parks for
+    linger_seconds, and a RECONNECTED login of the same user hands the new
+    socket to the parked thread instead of starting another one. If the
+    old connection still looks alive (the peer vanished without a FIN) the
+    acceptor shuts its socket down, the thread's read returns and it picks
+    up the new socket right away.
+
+    A thread that lingers without a reconnect, or sees shutdown, exits and
+    puts its client_t on the reap list. The acceptor joins and frees them
+    after every accept, so exited threads and their stacks do not pile up.
+
+    Only the acceptor (and the SIGINT handler, which runs on it) reads or
+    changes a user's client pointer, the client thread never does.
+*/
+
+#define CLIENT_ACTIVE 0
+#define CLIENT_PARKED 1
+#define CLIENT_DEAD 2
+
+typedef struct client {
+    session_t session;
+    pthread_t tid;
+    pthread_mutex_t mutex;    // guards state, nextFd and closing session.fd
+    pthread_cond_t cond;
+    int state;
+    int nextFd;               // socket of a reconnect not picked up yet, -1 if none
+    int slot;                 // -P slot the connection arrives on, the thread runs there
+    struct client * next;     // on the reap list once DEAD
+} client_t;
+
+static pthread_mutex_t reap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reap_cond = PTHREAD_COND_INITIALIZER;
+static client_t * reaped = NULL;
+static int liveThreads = 0;
+
+//serve the current connection until it ends
+static void client_serve(client_t * client) {
+    session_t * session = &client->session;
+    while (!shutdown_flag) {
+        //a sampled request's header read includes waiting for the client to send it
+        trace_request();
+        petrV_header header;
+        uint64_t t = trace_start();
+        if (rd_msgheader(session->fd, &header) != 0) {
+            // SO_RCVTIMEO ran out, see idle_seconds
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                atomic_fetch_add(&curStats.idleTimeouts, 1);
+            }
+            return;
+        }
+        trace_end("header read", t);
+        //read body of the message
+        t = trace_start();
+        char * body = malloc(header.msg_len);
+        if (read(session->fd, body, header.msg_len) < 0) {
+            free(body);
+            return;
+        }
+        trace_end("body read", t);
+        session->arrived = overload_clock();
+
+        t = trace_start();
+        int logged_out = handle_request(session, &header, body);
+        trace_end_detail(request_name(header.msg_type), session->local.username, t);
+        free(body);
+        session_send(session);
+        trace_request_end();
+        if (logged_out) {
+            return;
+        }
+    }
+}
+
+//Function running in thread
+static void * client_thread(void * arg) {
+    client_t * client = arg;
+    pin_thread(client->slot);
+
+    for (;;) {
+        client_serve(client);
+        //a read that failed left its request sampled
+        trace_request_end();
+
+        pthread_mutex_lock(&client->mutex);
+        close(client->session.fd);
+        client->session.fd = -1;
+        overload_disconnect();
+
+        //wait for the user to come back
+        client->state = CLIENT_PARKED;
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += linger_seconds;
+        while (client->nextFd < 0 && !shutdown_flag) {
+            if (pthread_cond_timedwait(&client->cond, &client->mutex, &until) == ETIMEDOUT) {
+                break;
+            }
+        }
+        if (shutdown_flag && client->nextFd >= 0) {
+            close(client->nextFd);
+            client->nextFd = -1;
+            overload_disconnect();
+        }
+        if (client->nextFd < 0) {
+            client->state = CLIENT_DEAD;
+            pthread_mutex_unlock(&client->mutex);
+            break;
+        }
+
+        session_release(&client->session);
+        session_init(&client->session, client->session.user, client->nextFd);
+        client->nextFd = -1;
+        client->state = CLIENT_ACTIVE;
+        int slot = client->slot;
+        pthread_mutex_unlock(&client->mutex);
+        //follow the connection to the core it arrives on
+        pin_thread(slot);
+    }
+
+    pthread_mutex_lock(&reap_mutex);
+    client->next = reaped;
+    reaped = client;
+    liveThreads--;
+    pthread_cond_signal(&reap_cond);
+    pthread_mutex_unlock(&reap_mutex);
+    return NULL;
+}
+
+//reuse the user's thread, O(1) and no thread is created
+static int client_reattach(client_t * client, int fd) {
+    pthread_mutex_lock(&client->mutex);
+    if (client->state == CLIENT_DEAD) {
+        pthread_mutex_unlock(&client->mutex);
+        return -1;
+    }
+
+    // a second reconnect before the thread got to the first one wins
+    if (client->nextFd >= 0) {
+        close(client->nextFd);
+        overload_disconnect();
+    }
+    client->nextFd = fd;
+    client->slot = pin_slot(fd);
+    if (client->state == CLIENT_ACTIVE) {
+        shutdown(client->session.fd, SHUT_RDWR);
+    } else {
+        pthread_cond_signal(&client->cond);
+    }
+    pthread_mutex_unlock(&client->mutex);
+
+    atomic_fetch_add(&curStats.reattached, 1);
+    return 0;
+}
+
+static int client_start(user_t * user, int fd) {
+    user_cold_t * cold = user_cold(user);
+    if (cold->client != NULL && client_reattach(cold->client, fd) == 0) {
+        return 0;
+    }
+
+    client_t * client = calloc(1, sizeof(client_t));
+    session_init(&client->session, user, fd);
+    pthread_mutex_init(&client->mutex, NULL);
+    pthread_cond_init(&client->cond, NULL);
+    client->state = CLIENT_ACTIVE;
+    client->nextFd = -1;
+    client->slot = pin_slot(fd);
+
+    pthread_mutex_lock(&reap_mutex);
+    int rc = pthread_create(&client->tid, NULL, client_thread, client);
+    if (rc == 0) {
+        liveThreads++;
+    }
+    pthread_mutex_unlock(&reap_mutex);
+
+    if (rc != 0) {
+        pthread_mutex_destroy(&client->mutex);
+        pthread_cond_destroy(&client->cond);
+        free(client);
+        return -1;
+    }
+    // an older DEAD client is still on the reap list and gets freed there
+    cold->client = client;
+
+    pthread_mutex_lock(&stats_mutex);
+    curStats.threadCnt++;
+    pthread_mutex_unlock(&stats_mutex);
+    return 0;
+}
+
+/*
+    SIGINT runs blocking_stop on the acceptor. It takes the users lock,
+    reap_mutex and every client's mutex, and frees the clients it joins,
+    so the acceptor holds it off while attaching (client mutex, reap_mutex,
+    the user's client pointer) and while reaping (reap_mutex, the clients
+    being freed). run_server does the same around login_user, which holds
+    the users lock. Threads started while attaching inherit the blocked
+    mask and never see SIGINT at all.
+*/
+static void sigint_block(sigset_t * old) {
+    sigset_t block;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &block, old);
+}
+
+int client_attach(user_t * user, int fd) {
+    sigset_t old;
+    sigint_block(&old);
+    int rc = client_start(user, fd);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return rc;
+}
+
+static void client_join(client_t * list) {
+    while (list != NULL) {
+        client_t * client = list;
+        list = client->next;
+        pthread_join(client->tid, NULL);
+
+        user_cold_t * cold = user_cold(client->session.user);
+        if (cold->client == client) {
+            cold->client = NULL;
+        }
+        session_release(&client->session);
+        pthread_mutex_destroy(&client->mutex);
+        pthread_cond_destroy(&client->cond);
+        free(client);
+        atomic_fetch_add(&curStats.reclaimed, 1);
+    }
+}
+
+static client_t * reap_take() {
+    pthread_mutex_lock(&reap_mutex);
+    client_t * list = reaped;
+    reaped = NULL;
+    pthread_mutex_unlock(&reap_mutex);
+    return list;
+}
+
+void client_reap() {
+    sigset_t old;
+    sigint_block(&old);
+    client_join(reap_take());
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+void blocking_stop() {
+    //wake every thread: readers through their socket, parked ones through their condition
+    users_rdlock();
+    for (int i = 0; i < userList->length; ++i) {
+        client_t * client = user_cold(VectorAt(userList, i))->client;
+        if (client == NULL) {
+            continue;
+        }
+        pthread_mutex_lock(&client->mutex);
+        if (client->state == CLIENT_ACTIVE) {
+            shutdown(client->session.fd, SHUT_RDWR);
+        } else {
+            pthread_cond_signal(&client->cond);
+        }
+        pthread_mutex_unlock(&client->mutex);
+    }
+    users_unlock();
+
+    //every thread ends on the reap list
+    pthread_mutex_lock(&reap_mutex);
+    while (liveThreads > 0) {
+        pthread_cond_wait(&reap_cond, &reap_mutex);
+    }
+    pthread_mutex_unlock(&reap_mutex);
+    client_join(reap_take());
+}
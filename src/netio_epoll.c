@@ -0,0 +1,216 @@
+#define _GNU_SOURCE
+#include "netio.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/*
+    epoll backend. A few scheduler threads each run an epoll loop over the
+    connections they accepted; a conn_t never moves between threads, so its
+    state machine needs no locking of its own. Every loop watches the
+    listening socket with EPOLLEXCLUSIVE and accepts one client per wakeup,
+    which spreads new connections over the threads.
+
+    With -P each scheduler is pinned to a CPU and accepts on a listener of
+    its own, cloned into the SO_REUSEPORT group with SO_INCOMING_CPU set,
+    so the kernel hands a connection to the scheduler on the core its
+    packets arrive on and the connection's state stays in that core's cache.
+*/
+
+#define EPOLL_EVENTS 64
+
+static int stop_fd = -1;
+static int shared_listen_fd = -1;
+static pthread_t * schedulers;
+static int scheduler_count;
+
+//send what is queued. Returns -1 if the connection is dead
+static int conn_flush(conn_t * conn) {
+    session_t * session = &conn->session;
+    size_t sent = 0;
+    while (sent < session->outLen) {
+        ssize_t n = send(session->fd, session->out + sent, session->outLen - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        sent += n;
+    }
+    memmove(session->out, session->out + sent, session->outLen - sent);
+    session->outLen -= sent;
+
+    // idle connections keep no reply buffer around
+    if (session->outLen == 0) {
+        free(session->out);
+        session->out = NULL;
+        session->outCap = 0;
+    }
+    return 0;
+}
+
+static void conn_close(int epfd, conn_t * conn) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, conn->session.fd, NULL);
+    close(conn->session.fd);
+    conn_free(conn);
+}
+
+static void accept_client(int epfd, int listen_fd) {
+    int client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK);
+    if (client_fd < 0) {
+        return;
+    }
+    socket_keepalive(client_fd);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = conn_new(client_fd);
+    epoll_ctl(epfd, EPOLL_CTL_ADD, client_fd, &ev);
+}
+
+//one scheduler thread
+static void * epoll_loop(void * arg) {
+    int slot = (int)(long)arg;
+    int listen_fd = shared_listen_fd;
+    int cpu = pin_thread(slot);
+    if (cpu >= 0 && slot > 0) {
+        int own = listener_clone(shared_listen_fd, cpu);
+        listen_fd = own >= 0 ? own : listen_fd;
+    } else if (cpu >= 0) {
+        setsockopt(listen_fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+    }
+
+    int epfd = epoll_create1(0);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.ptr = &listen_fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &stop_fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, stop_fd, &ev);
+
+    struct epoll_event events[EPOLL_EVENTS];
+    char buf[CONN_READ_SIZE];
+    int running = 1;
+    while (running) {
+        int n = epoll_wait(epfd, events, EPOLL_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        // everything read this round queued behind the events before it
+        uint64_t arrived = overload_clock();
+
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr == &stop_fd) {
+                running = 0;
+                continue;
+            }
+            if (events[i].data.ptr == &listen_fd) {
+                accept_client(epfd, listen_fd);
+                continue;
+            }
+
+            conn_t * conn = events[i].data.ptr;
+            int dead = 0;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                while (!conn->closing) {
+                    ssize_t got = recv(conn->session.fd, buf, sizeof(buf), 0);
+                    if (got < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        break;
+                    }
+                    if (got <= 0) {
+                        dead = 1;
+                        break;
+                    }
+                    conn->session.arrived = arrived;
+                    conn_input(conn, buf, got);
+                }
+            }
+
+            uint64_t t = trace_start();
+            if (!dead && conn_flush(conn) != 0) {
+                dead = 1;
+            }
+            trace_end("reply write", t);
+            trace_request_end();
+            if (dead || (conn->closing && conn->session.outLen == 0)) {
+                conn_close(epfd, conn);
+                continue;
+            }
+
+            // only ask for EPOLLOUT while replies are backed up
+            ev.events = EPOLLIN | (conn->session.outLen > 0 ? EPOLLOUT : 0);
+            ev.data.ptr = conn;
+            if ((events[i].events & EPOLLOUT) || conn->session.outLen > 0) {
+                epoll_ctl(epfd, EPOLL_CTL_MOD, conn->session.fd, &ev);
+            }
+        }
+    }
+
+    close(epfd);
+    if (listen_fd != shared_listen_fd) {
+        close(listen_fd);
+    }
+    return NULL;
+}
+
+int run_epoll(int listen_fd, int threads) {
+    stop_fd = eventfd(0, EFD_NONBLOCK);
+    if (stop_fd < 0) {
+        perror("eventfd");
+        exit(EXIT_FAILURE);
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    shared_listen_fd = listen_fd;
+
+    // SIGINT is taken by this thread only, so the handler never interrupts a request
+    sigset_t block, orig;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &block, &orig);
+
+    schedulers = malloc(threads * sizeof(pthread_t));
+    for (int i = 0; i < threads; ++i) {
+        if (pthread_create(&schedulers[i], NULL, epoll_loop, (void *)(long)i) != 0) {
+            printf("ERROR: Could not start scheduler thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    scheduler_count = threads;
+
+    while (!shutdown_flag) {
+        sigsuspend(&orig);
+    }
+    pthread_sigmask(SIG_SETMASK, &orig, NULL);
+
+    close(stop_fd);
+    free(schedulers);
+    return 0;
+}
+
+void epoll_stop() {
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) < 0) {
+        return;
+    }
+    for (int i = 0; i < scheduler_count; ++i) {
+        pthread_join(schedulers[i], NULL);
+    }
+}
@@ -0,0 +1,409 @@
+#include "netio.h"
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/*
+    io_uring backend, talking to the kernel through the raw syscalls.
+
+    One multishot accept produces every new connection, and each connection
+    gets one multishot recv that picks its buffers from a ring of provided
+    buffers registered with the kernel, so reading costs no syscalls at all.
+    Replies are queued by the handlers and sent with IORING_OP_SEND; all
+    submissions made while draining a batch of completions go to the kernel
+    in the same io_uring_enter that waits for the next batch.
+
+    user_data carries the conn_t pointer with the operation in its low bits.
+*/
+
+#define URING_ENTRIES 256
+#define URING_BUFS 256
+#define URING_BGID 0
+
+#define OP_ACCEPT 1
+#define OP_RECV 2
+#define OP_SEND 3
+#define OP_MASK 3ull
+
+/*
+ * Connection state on top of conn_t.
+ *
+ * sending - reply bytes handed to the kernel, sendLen long, sendOff of them sent.
+ *           Swapped with session.out (and sendCap with outCap) once fully sent.
+ * recvArmed/sendArmed - operations in flight, the connection is freed once
+ *                       it is closing and both are clear.
+ */
+typedef struct {
+    conn_t conn;
+    char * sending;
+    size_t sendCap;
+    size_t sendLen;
+    size_t sendOff;
+    int recvArmed;
+    int sendArmed;
+    int shut;
+} uconn_t;
+
+typedef struct {
+    int fd;
+    char * sqRing;
+    size_t sqRingSize;
+    size_t sqesSize;
+    unsigned * sqHead;
+    unsigned * sqTail;
+    unsigned sqMask;
+    unsigned * sqArray;
+    struct io_uring_sqe * sqes;
+    unsigned * cqHead;
+    unsigned * cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe * cqes;
+    unsigned toSubmit;
+
+    struct io_uring_buf_ring * bufRing;
+    char * bufs;
+    unsigned bufTail;
+    uint64_t arrived;  // when the current batch of completions was reaped
+} uring_t;
+
+//unmap and free whatever uring_setup got to, the buffers last once the ring is gone
+static void uring_free(uring_t * ring) {
+    if (ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    if (ring->sqRing != MAP_FAILED) {
+        munmap(ring->sqRing, ring->sqRingSize);
+    }
+    close(ring->fd);
+    if (ring->bufRing != MAP_FAILED) {
+        munmap(ring->bufRing, URING_BUFS * sizeof(struct io_uring_buf));
+    }
+    free(ring->bufs);
+}
+
+static int uring_setup(uring_t * ring) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ring->sqRing = MAP_FAILED;
+    ring->sqes = MAP_FAILED;
+    ring->bufRing = MAP_FAILED;
+    ring->bufs = NULL;
+    ring->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    if (ring->fd < 0) {
+        return -1;
+    }
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        uring_free(ring);
+        return -1;
+    }
+
+    size_t sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqRingSize = sqSize > cqSize ? sqSize : cqSize;
+    ring->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqRing == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        uring_free(ring);
+        return -1;
+    }
+
+    char * sq = ring->sqRing;
+    ring->sqHead = (unsigned *)(sq + p.sq_off.head);
+    ring->sqTail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sqMask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)(sq + p.sq_off.array);
+    ring->cqHead = (unsigned *)(sq + p.cq_off.head);
+    ring->cqTail = (unsigned *)(sq + p.cq_off.tail);
+    ring->cqMask = *(unsigned *)(sq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(sq + p.cq_off.cqes);
+    ring->toSubmit = 0;
+
+    // provided buffer ring, the kernel picks a buffer for every recv completion
+    size_t bufRingSize = URING_BUFS * sizeof(struct io_uring_buf);
+    ring->bufRing = mmap(NULL, bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ring->bufs = malloc(URING_BUFS * CONN_READ_SIZE);
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)ring->bufRing;
+    reg.ring_entries = URING_BUFS;
+    reg.bgid = URING_BGID;
+    if (ring->bufRing == MAP_FAILED || ring->bufs == NULL ||
+        syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        uring_free(ring);
+        return -1;
+    }
+
+    ring->bufTail = 0;
+    for (int i = 0; i < URING_BUFS; ++i) {
+        struct io_uring_buf * buf = &ring->bufRing->bufs[i];
+        buf->addr = (unsigned long)(ring->bufs + i * CONN_READ_SIZE);
+        buf->len = CONN_READ_SIZE;
+        buf->bid = i;
+    }
+    ring->bufTail = URING_BUFS;
+    atomic_store_explicit((_Atomic unsigned short *)&ring->bufRing->tail, ring->bufTail, memory_order_release);
+    return 0;
+}
+
+static void buf_recycle(uring_t * ring, int bid) {
+    struct io_uring_buf * buf = &ring->bufRing->bufs[ring->bufTail & (URING_BUFS - 1)];
+    buf->addr = (unsigned long)(ring->bufs + bid * CONN_READ_SIZE);
+    buf->len = CONN_READ_SIZE;
+    buf->bid = bid;
+    ring->bufTail++;
+    atomic_store_explicit((_Atomic unsigned short *)&ring->bufRing->tail, ring->bufTail, memory_order_release);
+}
+
+//mask, if given, is the signal mask while waiting, as with ppoll
+static int uring_enter(uring_t * ring, unsigned wait, const sigset_t * mask) {
+    int rc = syscall(__NR_io_uring_enter, ring->fd, ring->toSubmit, wait, wait ? IORING_ENTER_GETEVENTS : 0, mask,
+                     mask ? _NSIG / 8 : 0);
+    if (rc >= 0) {
+        ring->toSubmit -= rc;
+    }
+    return rc;
+}
+
+static struct io_uring_sqe * get_sqe(uring_t * ring) {
+    unsigned head = atomic_load_explicit((_Atomic unsigned *)ring->sqHead, memory_order_acquire);
+    unsigned tail = *ring->sqTail;
+    if (tail - head > ring->sqMask) {
+        // ring is full, hand what we have to the kernel first
+        uring_enter(ring, 0, NULL);
+        head = atomic_load_explicit((_Atomic unsigned *)ring->sqHead, memory_order_acquire);
+        if (tail - head > ring->sqMask) {
+            return NULL;
+        }
+    }
+
+    struct io_uring_sqe * sqe = &ring->sqes[tail & ring->sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sqArray[tail & ring->sqMask] = tail & ring->sqMask;
+    atomic_store_explicit((_Atomic unsigned *)ring->sqTail, tail + 1, memory_order_release);
+    ring->toSubmit++;
+    return sqe;
+}
+
+static void arm_accept(uring_t * ring, int listen_fd) {
+    struct io_uring_sqe * sqe = get_sqe(ring);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = OP_ACCEPT;
+}
+
+static void arm_recv(uring_t * ring, uconn_t * uc) {
+    struct io_uring_sqe * sqe = get_sqe(ring);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = uc->conn.session.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = (unsigned long)uc | OP_RECV;
+    uc->recvArmed = 1;
+}
+
+/*
+    Provided buffer rings came in 5.19 but multishot recv only in 6.0, and
+    5.19 fails such a recv with -EINVAL only once a client has connected.
+    Try one on a socketpair whose peer is gone: a kernel that has it ends
+    the recv with EOF, one that does not rejects it.
+*/
+static int uring_probe_recv(uring_t * ring) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        return -1;
+    }
+    close(sv[1]);
+
+    uconn_t probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.conn.session.fd = sv[0];
+    arm_recv(ring, &probe);
+    int rc = 0;
+    while (probe.recvArmed) {
+        if (uring_enter(ring, 1, NULL) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            rc = -1;
+            break;
+        }
+        unsigned head = *ring->cqHead;
+        unsigned tail = atomic_load_explicit((_Atomic unsigned *)ring->cqTail, memory_order_acquire);
+        for (; head != tail; ++head) {
+            struct io_uring_cqe * cqe = &ring->cqes[head & ring->cqMask];
+            if (cqe->flags & IORING_CQE_F_BUFFER) {
+                buf_recycle(ring, cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            }
+            if (cqe->res < 0) {
+                rc = -1;
+            }
+            if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                probe.recvArmed = 0;
+            }
+        }
+        atomic_store_explicit((_Atomic unsigned *)ring->cqHead, head, memory_order_release);
+    }
+    close(sv[0]);
+    return rc;
+}
+
+//hand the queued replies to the kernel, one send in flight per connection
+static void arm_send(uring_t * ring, uconn_t * uc) {
+    session_t * session = &uc->conn.session;
+    if (uc->sendArmed) {
+        return;
+    }
+    if (uc->sendOff == uc->sendLen) {
+        if (session->outLen == 0) {
+            return;
+        }
+        // swap buffers so handlers can keep queueing while this one is in flight
+        char * tmp = uc->sending;
+        size_t tmpCap = uc->sendCap;
+        uc->sending = session->out;
+        uc->sendCap = session->outCap;
+        uc->sendLen = session->outLen;
+        uc->sendOff = 0;
+        session->out = tmp;
+        session->outCap = tmpCap;
+        session->outLen = 0;
+    }
+
+    struct io_uring_sqe * sqe = get_sqe(ring);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = session->fd;
+    sqe->addr = (unsigned long)(uc->sending + uc->sendOff);
+    sqe->len = uc->sendLen - uc->sendOff;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (unsigned long)uc | OP_SEND;
+    uc->sendArmed = 1;
+}
+
+//close once nothing is in flight, shutting the socket down ends the multishot recv
+static void maybe_close(uconn_t * uc) {
+    if (!uc->conn.closing || uc->sendArmed) {
+        return;
+    }
+    if (uc->recvArmed) {
+        if (!uc->shut) {
+            shutdown(uc->conn.session.fd, SHUT_RDWR);
+            uc->shut = 1;
+        }
+        return;
+    }
+    close(uc->conn.session.fd);
+    free(uc->sending);
+    conn_free(&uc->conn);
+}
+
+static void on_recv(uring_t * ring, uconn_t * uc, struct io_uring_cqe * cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        uc->recvArmed = 0;
+    }
+
+    if (cqe->res > 0) {
+        int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (!uc->conn.closing) {
+            uc->conn.session.arrived = ring->arrived;
+            conn_input(&uc->conn, ring->bufs + bid * CONN_READ_SIZE, cqe->res);
+            trace_request_end();
+        }
+        buf_recycle(ring, bid);
+    } else if (cqe->res != -ENOBUFS) {
+        uc->conn.closing = 1;
+    }
+
+    // out of buffers or the kernel ended the multishot, start another one
+    if (!uc->recvArmed && !uc->conn.closing) {
+        arm_recv(ring, uc);
+    }
+    arm_send(ring, uc);
+    maybe_close(uc);
+}
+
+static void on_send(uring_t * ring, uconn_t * uc, struct io_uring_cqe * cqe) {
+    uc->sendArmed = 0;
+    if (cqe->res < 0) {
+        uc->sendOff = uc->sendLen;
+        uc->conn.session.outLen = 0;
+        uc->conn.closing = 1;
+    } else {
+        uc->sendOff += cqe->res;
+        arm_send(ring, uc);
+    }
+    maybe_close(uc);
+}
+
+int run_uring(int listen_fd) {
+    uring_t ring;
+    if (uring_setup(&ring) != 0) {
+        return -1;
+    }
+    if (uring_probe_recv(&ring) != 0) {
+        uring_free(&ring);
+        return -1;
+    }
+
+    // SIGINT only lands while waiting, never in the middle of a request
+    sigset_t block, orig;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &block, &orig);
+
+    int accepted = 0;
+    arm_accept(&ring, listen_fd);
+    while (!shutdown_flag) {
+        if (uring_enter(&ring, 1, &orig) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("io_uring_enter");
+            break;
+        }
+        ring.arrived = overload_clock();
+
+        unsigned head = *ring.cqHead;
+        unsigned tail = atomic_load_explicit((_Atomic unsigned *)ring.cqTail, memory_order_acquire);
+        for (; head != tail; ++head) {
+            struct io_uring_cqe cqe = ring.cqes[head & ring.cqMask];
+            uconn_t * uc = (uconn_t *)(unsigned long)(cqe.user_data & ~OP_MASK);
+
+            switch (cqe.user_data & OP_MASK) {
+            case OP_ACCEPT:
+                if (cqe.res >= 0) {
+                    accepted = 1;
+                    uc = calloc(1, sizeof(uconn_t));
+                    uc->conn.session.fd = cqe.res;
+                    socket_keepalive(cqe.res);
+                    arm_recv(&ring, uc);
+                } else if (!accepted && cqe.res == -EINVAL) {
+                    // kernel without multishot accept, nothing has been served yet
+                    uring_free(&ring);
+                    pthread_sigmask(SIG_SETMASK, &orig, NULL);
+                    return -1;
+                }
+                if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                    arm_accept(&ring, listen_fd);
+                }
+                break;
+            case OP_RECV:
+                on_recv(&ring, uc, &cqe);
+                break;
+            case OP_SEND:
+                on_send(&ring, uc, &cqe);
+                break;
+            }
+        }
+        atomic_store_explicit((_Atomic unsigned *)ring.cqHead, head, memory_order_release);
+    }
+
+    uring_free(&ring);
+    pthread_sigmask(SIG_SETMASK, &orig, NULL);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "overload.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+    Admission control. Three limits keep an overloaded server answering:
+    the number of logged in connections, the number of mutating requests
+    queued for the course locks and, as in CoDel, the time requests spend
+    between being read and being admitted. Whatever is over a limit is
+    answered right away with ESERV instead of waiting its turn, so the
+    students already being served keep their latency.
+*/
+
+static int maxClients = 0;
+static unsigned long queueLimit = 0;
+static uint64_t targetUs = 0;
+static atomic_int activeClients = 0;
+
+static pthread_mutex_t codel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t firstAbove = 0;   // when the delay will have been above target for an interval
+static uint64_t dropNext = 0;     // next time a request is shed while dropping
+static unsigned dropCount = 0;
+static int dropping = 0;
+
+void overload_init(int max_clients, int queue_depth, int workers, int target_ms) {
+    maxClients = max_clients > 0 ? max_clients : 0;
+    queueLimit = queue_depth > 0 ? (unsigned long)queue_depth * (workers > 0 ? workers : 1) : 0;
+    targetUs = target_ms > 0 ? (uint64_t)target_ms * 1000 : 0;
+}
+
+uint64_t overload_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int overload_connect() {
+    if (atomic_fetch_add(&activeClients, 1) >= maxClients && maxClients > 0) {
+        atomic_fetch_sub(&activeClients, 1);
+        return -1;
+    }
+    return 0;
+}
+
+void overload_disconnect() {
+    atomic_fetch_sub(&activeClients, 1);
+}
+
+int overload_queue(unsigned long waiting) {
+    return (queueLimit > 0 && waiting >= queueLimit) ? -1 : 0;
+}
+
+static unsigned isqrt(unsigned n) {
+    unsigned r = 0;
+    while ((r + 1) * (r + 1) <= n) {
+        r++;
+    }
+    return r;
+}
+
+int overload_dequeue(uint64_t arrived) {
+    if (targetUs == 0) {
+        return 0;
+    }
+    uint64_t now = overload_clock();
+    uint64_t sojourn = now > arrived ? now - arrived : 0;
+
+    pthread_mutex_lock(&codel_mutex);
+    int okToDrop = 0;
+    if (sojourn < targetUs) {
+        firstAbove = 0;
+    } else if (firstAbove == 0) {
+        firstAbove = now + OVERLOAD_INTERVAL_US;
+    } else if (now >= firstAbove) {
+        okToDrop = 1;
+    }
+
+    int shed = 0;
+    if (dropping) {
+        if (!okToDrop) {
+            dropping = 0;
+        } else if (now >= dropNext) {
+            shed = 1;
+            dropCount++;
+            dropNext = now + OVERLOAD_INTERVAL_US / isqrt(dropCount);
+        }
+    } else if (okToDrop) {
+        // start where the last episode left off if it ended recently
+        shed = 1;
+        dropping = 1;
+        dropCount = (dropCount > 2 && now - dropNext < 16 * OVERLOAD_INTERVAL_US) ? dropCount - 2 : 1;
+        dropNext = now + OVERLOAD_INTERVAL_US / isqrt(dropCount);
+    }
+    pthread_mutex_unlock(&codel_mutex);
+    return shed ? -1 : 0;
+}
+
+int overload_retry_after() {
+    return OVERLOAD_INTERVAL_US / 1000;
+}
@@ -0,0 +1,100 @@
+#include "prereq.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char* username;
+    uint32_t completed;
+} completed_entry_t;
+
+static completed_entry_t* completedTable = NULL;
+static int completedCnt = 0;
+
+static int completed_comparator(const void * a, const void * b) {
+    return strcmp(((const completed_entry_t *)a)->username, ((const completed_entry_t *)b)->username);
+}
+
+uint32_t parse_course_set(char * value) {
+    uint32_t set = 0;
+    char * save = NULL;
+    char * tok = strtok_r(value, ",", &save);
+    while (tok != NULL) {
+        int index = atoi(tok);
+        if (index >= 0 && index < 32) {
+            set |= (1u << index);
+        }
+        tok = strtok_r(NULL, ",", &save);
+    }
+    return set;
+}
+
+#define VISIT_NEW 0
+#define VISIT_PATH 1   // on the path the search is following
+#define VISIT_DONE 2
+
+//depth first from course i, -1 if it reaches a course on its own path
+static int prereq_visit(const uint32_t * prereqs, int course_cnt, int i, uint8_t * state) {
+    state[i] = VISIT_PATH;
+    for (uint32_t left = prereqs[i]; left != 0; left &= left - 1) {
+        int j = __builtin_ctz(left);
+        if (j >= course_cnt) {
+            continue;
+        }
+        if (state[j] == VISIT_PATH ||
+            (state[j] == VISIT_NEW && prereq_visit(prereqs, course_cnt, j, state) != 0)) {
+            return -1;
+        }
+    }
+    state[i] = VISIT_DONE;
+    return 0;
+}
+
+int check_prereqs(const uint32_t * prereqs, int course_cnt) {
+    uint8_t state[32] = {0};
+    for (int i = 0; i < course_cnt; ++i) {
+        if (state[i] == VISIT_NEW && prereq_visit(prereqs, course_cnt, i, state) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void load_completed(const char * file_name) {
+    if (file_name == NULL) {
+        return;
+    }
+
+    FILE * f = fopen(file_name, "r");
+    if (!f) {
+        printf("ERROR: Could not open completed course file\n");
+        exit(2);
+    }
+
+    char line[512];
+    int cap = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char * username = strtok(line, ";\r\n");
+        char * temp = strtok(NULL, ";\r\n");
+        if (username == NULL) {
+            continue;
+        }
+
+        if (completedCnt == cap) {
+            cap = cap ? cap * 2 : 64;
+            completedTable = realloc(completedTable, cap * sizeof(completed_entry_t));
+        }
+        completedTable[completedCnt].username = strdup(username);
+        completedTable[completedCnt].completed = temp ? parse_course_set(temp) : 0;
+        completedCnt++;
+    }
+    fclose(f);
+
+    qsort(completedTable, completedCnt, sizeof(completed_entry_t), completed_comparator);
+}
+
+uint32_t lookup_completed(const char * username) {
+    completed_entry_t key = { (char *)username, 0 };
+    completed_entry_t * found = bsearch(&key, completedTable, completedCnt, sizeof(completed_entry_t), completed_comparator);
+    return found ? found->completed : 0;
+}
@@ -0,0 +1,122 @@
+#include "priority.h"
+#include "overload.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    char* username;
+    int group;
+} group_entry_t;
+
+static group_entry_t* groups = NULL;
+static int groupCnt = 0;
+static uint64_t startMs = 0;
+
+static pthread_mutex_t admission_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t admission_cond = PTHREAD_COND_INITIALIZER;
+static unsigned long nextTicket = 0;
+static unsigned long doneTicket = 0;
+static int admissionSlots = 1;
+
+static int group_comparator(const void * a, const void * b) {
+    return strcmp(((const group_entry_t *)a)->username, ((const group_entry_t *)b)->username);
+}
+
+uint64_t window_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void load_groups(const char * file_name) {
+    startMs = window_clock();
+    if (file_name == NULL) {
+        return;
+    }
+
+    FILE * f = fopen(file_name, "r");
+    if (!f) {
+        printf("ERROR: Could not open group file\n");
+        exit(2);
+    }
+
+    char line[256];
+    int cap = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char * username = strtok(line, ";");
+        char * temp = strtok(NULL, ";\r\n");
+        if (username == NULL || temp == NULL) {
+            continue;
+        }
+        int group = atoi(temp);
+        if (group < 0 || group >= PRIORITY_GROUPS) {
+            group = PRIORITY_GROUPS - 1;
+        }
+
+        if (groupCnt == cap) {
+            cap = cap ? cap * 2 : 64;
+            groups = realloc(groups, cap * sizeof(group_entry_t));
+        }
+        groups[groupCnt].username = strdup(username);
+        groups[groupCnt].group = group;
+        groupCnt++;
+    }
+    fclose(f);
+
+    qsort(groups, groupCnt, sizeof(group_entry_t), group_comparator);
+}
+
+int lookup_group(const char * username) {
+    group_entry_t key = { (char *)username, 0 };
+    group_entry_t * found = bsearch(&key, groups, groupCnt, sizeof(group_entry_t), group_comparator);
+    return found ? found->group : PRIORITY_GROUPS - 1;
+}
+
+void parse_window(char * value, uint64_t * open_at) {
+    int g = 0;
+    uint64_t last = 0;
+    char * save = NULL;
+    char * tok = strtok_r(value, ",", &save);
+    while (tok != NULL && g < PRIORITY_GROUPS) {
+        last = (uint64_t)atol(tok) * 1000;
+        open_at[g++] = startMs + last;
+        tok = strtok_r(NULL, ",", &save);
+    }
+    while (g < PRIORITY_GROUPS) {
+        open_at[g++] = startMs + last;
+    }
+}
+
+void admission_init(int slots) {
+    admissionSlots = slots > 0 ? slots : 1;
+}
+
+int admission_enter(uint64_t arrived) {
+    pthread_mutex_lock(&admission_mutex);
+    unsigned long queued = nextTicket - doneTicket;
+    if (queued > (unsigned long)admissionSlots && overload_queue(queued - admissionSlots) != 0) {
+        pthread_mutex_unlock(&admission_mutex);
+        return -1;
+    }
+    unsigned long ticket = nextTicket++;
+    while (ticket >= doneTicket + admissionSlots) {
+        pthread_cond_wait(&admission_cond, &admission_mutex);
+    }
+    pthread_mutex_unlock(&admission_mutex);
+
+    if (overload_dequeue(arrived) != 0) {
+        admission_exit();
+        return -1;
+    }
+    return 0;
+}
+
+void admission_exit() {
+    pthread_mutex_lock(&admission_mutex);
+    doneTicket++;
+    pthread_cond_broadcast(&admission_cond);
+    pthread_mutex_unlock(&admission_mutex);
+}
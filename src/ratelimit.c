@@ -0,0 +1,34 @@
+#include "ratelimit.h"
+
+#define TOKEN 1000000ull   // one token in bucket units
+
+static uint64_t rates[2] = {0, 0};
+
+void ratelimit_init(int read_rate, int write_rate) {
+    rates[RATE_READ] = read_rate > 0 ? read_rate : 0;
+    rates[RATE_WRITE] = write_rate > 0 ? write_rate : 0;
+}
+
+int ratelimit_take(bucket_t * bucket, int kind, uint64_t now) {
+    uint64_t rate = rates[kind];
+    if (rate == 0) {
+        return 0;
+    }
+
+    // refill: rate tokens per second is rate bucket units per microsecond
+    uint64_t burst = rate * TOKEN;
+    if (bucket->last == 0) {
+        bucket->tokens = burst;
+    } else if (now > bucket->last) {
+        uint64_t refill = (now - bucket->last) * rate;
+        bucket->tokens = burst - bucket->tokens <= refill ? burst : bucket->tokens + refill;
+    }
+    bucket->last = now;
+
+    if (bucket->tokens >= TOKEN) {
+        bucket->tokens -= TOKEN;
+        return 0;
+    }
+    uint64_t wait_us = (TOKEN - bucket->tokens + rate - 1) / rate;
+    return (wait_us + 999) / 1000;
+}
@@ -0,0 +1,56 @@
+#include "schedule.h"
+#include <stdio.h>
+#include <string.h>
+
+static int day_index(char c) {
+    const char * days = "MTWRFSU";
+    const char * p = strchr(days, c);
+    return (p != NULL && c != '\0') ? (int)(p - days) : -1;
+}
+
+static void set_slots(weekmask_t * mask, int from, int to) {
+    for (int s = from; s < to; ++s) {
+        mask->w[s / 64] |= 1ull << (s % 64);
+    }
+}
+
+int parse_meetings(char * value, weekmask_t * out) {
+    memset(out, 0, sizeof(*out));
+
+    char * save = NULL;
+    char * block = strtok_r(value, ",", &save);
+    while (block != NULL) {
+        int ndays = 0;
+        int days[7];
+        while (day_index(*block) >= 0 && ndays < 7) {
+            days[ndays++] = day_index(*block);
+            block++;
+        }
+
+        int sh, sm, eh, em;
+        if (ndays == 0 || sscanf(block, "%2d%2d-%2d%2d", &sh, &sm, &eh, &em) != 4) {
+            return -1;
+        }
+        // a block ending at 10:50 occupies up to, not including, 10:50
+        int from = (sh * 60 + sm) / SLOT_MINUTES;
+        int to = (eh * 60 + em + SLOT_MINUTES - 1) / SLOT_MINUTES;
+        if (from >= to || to > 24 * 60 / SLOT_MINUTES) {
+            return -1;
+        }
+
+        for (int d = 0; d < ndays; ++d) {
+            int base = days[d] * 24 * 60 / SLOT_MINUTES;
+            set_slots(out, base + from, base + to);
+        }
+        block = strtok_r(NULL, ",", &save);
+    }
+    return 0;
+}
+
+int weekmask_overlaps(const weekmask_t * a, const weekmask_t * b) {
+    uint64_t any = 0;
+    for (int i = 0; i < WEEK_WORDS; ++i) {
+        any |= a->w[i] & b->w[i];
+    }
+    return any != 0;
+}
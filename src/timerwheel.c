@@ -0,0 +1,198 @@
+#include "timerwheel.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+    Hierarchical timing wheel.
+
+    Level 0 has one slot per tick, level n has one slot per 64^n ticks, so four
+    levels of 64 slots cover 2^24 ticks (about 19 days at 100ms). A timer is
+    placed on the lowest level whose span still contains its expiry, which makes
+    arming and cancelling a list splice. Every time level 0 wraps around, the
+    next slot of level 1 is emptied and its timers are placed again one level
+    lower (and so on up the levels), so each timer is moved at most once per level.
+
+    Each slot is a circular doubly linked list with the slot itself as sentinel.
+*/
+
+static wheel_timer_t wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static uint64_t curTick = 0;
+static pthread_mutex_t wheel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wheel_cond;   // on CLOCK_MONOTONIC, signalled by timerwheel_stop
+static pthread_t wheel_tid;
+static int running = 0;
+static int stopping = 0;            // guarded by wheel_mutex
+
+static void slot_append(wheel_timer_t* slot, wheel_timer_t* t) {
+    t->prev = slot->prev;
+    t->next = slot;
+    slot->prev->next = t;
+    slot->prev = t;
+}
+
+static void slot_unlink(wheel_timer_t* t) {
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+}
+
+/* must hold wheel_mutex */
+static void wheel_add(wheel_timer_t* t) {
+    uint64_t delta = t->expires > curTick ? t->expires - curTick : 0;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ull << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    uint64_t when = delta == 0 ? curTick : t->expires;
+    // anything further out than the top level can hold waits in its last slot
+    if (delta >= (1ull << (WHEEL_BITS * WHEEL_LEVELS)))
+        when = curTick + (1ull << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    int idx = (when >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+    slot_append(&wheel[level][idx], t);
+}
+
+/* must hold wheel_mutex. @return the slot index that was cascaded */
+static int cascade(int level) {
+    int idx = (curTick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+    wheel_timer_t* slot = &wheel[level][idx];
+
+    wheel_timer_t* t = slot->next;
+    slot->next = slot->prev = slot;
+    while (t != slot) {
+        wheel_timer_t* next = t->next;
+        wheel_add(t);
+        t = next;
+    }
+    return idx;
+}
+
+/*
+ * Advance the wheel by one tick and collect what expired.
+ * @return singly linked (through next) list of expired timers
+ */
+static wheel_timer_t* wheel_tick() {
+    int idx = curTick & (WHEEL_SLOTS - 1);
+    if (idx == 0) {
+        for (int level = 1; level < WHEEL_LEVELS; ++level) {
+            if (cascade(level) != 0)
+                break;
+        }
+    }
+
+    wheel_timer_t* slot = &wheel[0][idx];
+    wheel_timer_t* expired = NULL;
+    wheel_timer_t* t = slot->next;
+    while (t != slot) {
+        wheel_timer_t* next = t->next;
+        t->armed = 0;
+        t->prev = NULL;
+        t->next = expired;
+        expired = t;
+        t = next;
+    }
+    slot->next = slot->prev = slot;
+
+    curTick++;
+    return expired;
+}
+
+static uint64_t now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void* wheel_thread(void* arg) {
+    // leave SIGINT to the connection threads
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    uint64_t start = now_ms();
+    while (1) {
+        struct timespec until;
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        until.tv_nsec += WHEEL_TICK_MS * 1000000L;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&wheel_mutex);
+        while (!stopping && pthread_cond_timedwait(&wheel_cond, &wheel_mutex, &until) != ETIMEDOUT) {
+        }
+        pthread_mutex_unlock(&wheel_mutex);
+
+        // catch up if we slept longer than a tick
+        uint64_t target = (now_ms() - start) / WHEEL_TICK_MS;
+        while (1) {
+            pthread_mutex_lock(&wheel_mutex);
+            if (stopping) {
+                pthread_mutex_unlock(&wheel_mutex);
+                return NULL;
+            }
+            if (curTick >= target) {
+                pthread_mutex_unlock(&wheel_mutex);
+                break;
+            }
+            wheel_timer_t* expired = wheel_tick();
+            pthread_mutex_unlock(&wheel_mutex);
+
+            while (expired != NULL) {
+                wheel_timer_t* next = expired->next;
+                expired->next = NULL;
+                expired->callback(expired);
+                expired = next;
+            }
+        }
+    }
+    return NULL;
+}
+
+void timerwheel_start() {
+    for (int level = 0; level < WHEEL_LEVELS; ++level) {
+        for (int i = 0; i < WHEEL_SLOTS; ++i) {
+            wheel[level][i].next = wheel[level][i].prev = &wheel[level][i];
+        }
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wheel_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    running = pthread_create(&wheel_tid, NULL, wheel_thread, NULL) == 0;
+}
+
+void timerwheel_stop() {
+    if (!running) {
+        return;
+    }
+    pthread_mutex_lock(&wheel_mutex);
+    stopping = 1;
+    pthread_cond_signal(&wheel_cond);
+    pthread_mutex_unlock(&wheel_mutex);
+    pthread_join(wheel_tid, NULL);
+    running = 0;
+}
+
+void timer_arm(wheel_timer_t* t, uint64_t delay_ms) {
+    pthread_mutex_lock(&wheel_mutex);
+    t->expires = curTick + (delay_ms + WHEEL_TICK_MS - 1) / WHEEL_TICK_MS;
+    t->armed = 1;
+    wheel_add(t);
+    pthread_mutex_unlock(&wheel_mutex);
+}
+
+int timer_cancel(wheel_timer_t* t) {
+    pthread_mutex_lock(&wheel_mutex);
+    int pending = t->armed;
+    if (pending) {
+        slot_unlink(t);
+        t->armed = 0;
+    }
+    pthread_mutex_unlock(&wheel_mutex);
+    return pending;
+}
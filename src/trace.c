@@ -0,0 +1,138 @@
+#include "trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    Every thread that serves a sampled request gets a span buffer only it
+    writes to, so recording a span takes no lock. Buffers are pushed onto
+    a global list with a CAS so trace_close can find them all. A full
+    buffer is written out by its own thread under file_mutex, the only
+    lock tracing ever takes, and that happens once per TRACE_BUFFER spans.
+*/
+
+typedef struct {
+    const char * name;
+    char detail[32];
+    uint64_t start;
+    uint64_t end;
+    uint32_t request;
+} span_t;
+
+typedef struct trace_buf {
+    struct trace_buf * next;
+    int tid;
+    uint32_t request;   // current sampled request of this thread
+    int count;
+    span_t spans[TRACE_BUFFER];
+} trace_buf_t;
+
+__thread int trace_sampled = 0;
+
+static __thread trace_buf_t * buf = NULL;
+static _Atomic(trace_buf_t *) buffers = NULL;
+static atomic_int nextTid = 1;
+static int sampleEvery = 0;
+// requests this thread has started, each thread samples on its own count
+static __thread unsigned seen = 0;
+static uint64_t epoch = 0;
+
+static FILE * file = NULL;
+static pthread_mutex_t file_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int written = 0;
+
+void trace_init(const char * file_name, int sample_every) {
+    file = fopen(file_name, "w");
+    if (!file) {
+        printf("ERROR: Could not open trace file\n");
+        exit(2);
+    }
+    fprintf(file, "[\n");
+    epoch = trace_clock();
+    sampleEvery = sample_every > 0 ? sample_every : 1;
+}
+
+void trace_request() {
+    if (sampleEvery == 0) {
+        return;
+    }
+    trace_sampled = seen++ % sampleEvery == 0;
+    if (!trace_sampled) {
+        return;
+    }
+
+    if (buf == NULL) {
+        buf = calloc(1, sizeof(trace_buf_t));
+        buf->tid = atomic_fetch_add(&nextTid, 1);
+        buf->next = atomic_load(&buffers);
+        while (!atomic_compare_exchange_weak(&buffers, &buf->next, buf)) {
+        }
+    }
+    buf->request++;
+}
+
+static void write_detail(const char * detail) {
+    fputc('"', file);
+    for (const char * c = detail; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if ((unsigned char)*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+//must hold file_mutex
+static void write_spans(trace_buf_t * b) {
+    for (int i = 0; i < b->count; ++i) {
+        span_t * s = &b->spans[i];
+        fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"req\":%u",
+                written++ ? ",\n" : "", s->name, (s->start - epoch) / 1e3, (s->end - s->start) / 1e3, b->tid,
+                s->request);
+        if (s->detail[0] != '\0') {
+            fprintf(file, ",\"detail\":");
+            write_detail(s->detail);
+        }
+        fprintf(file, "}}");
+    }
+    b->count = 0;
+}
+
+void trace_record(const char * name, const char * detail, uint64_t start) {
+    if (buf->count == TRACE_BUFFER) {
+        pthread_mutex_lock(&file_mutex);
+        if (file != NULL) {
+            write_spans(buf);
+        }
+        buf->count = 0;
+        pthread_mutex_unlock(&file_mutex);
+    }
+
+    span_t * s = &buf->spans[buf->count++];
+    s->name = name;
+    snprintf(s->detail, sizeof(s->detail), "%s", detail != NULL ? detail : "");
+    s->start = start;
+    s->end = trace_clock();
+    s->request = buf->request;
+}
+
+void trace_close() {
+    if (sampleEvery == 0) {
+        return;
+    }
+    sampleEvery = 0;
+
+    pthread_mutex_lock(&file_mutex);
+    for (trace_buf_t * b = atomic_load(&buffers); b != NULL; b = b->next) {
+        write_spans(b);
+    }
+    fprintf(file, "\n]\n");
+    fclose(file);
+    file = NULL;
+    pthread_mutex_unlock(&file_mutex);
+}
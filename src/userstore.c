@@ -0,0 +1,85 @@
+#include "userstore.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    Users live in chunks, each a struct of two arrays: the hot records
+    every request touches and the cold records that are only needed at
+    login and shutdown. Scanning or looking up hot records never pulls
+    sockets, thread ids or sequence tables into cache.
+
+    The chunk table has a fixed size and a chunk never moves once
+    allocated, so user_cold can index it without a lock while another
+    thread creates users.
+*/
+
+typedef struct {
+    user_t hot[USER_CHUNK];
+    user_cold_t cold[USER_CHUNK];
+} user_chunk_t;
+
+static user_chunk_t * chunks[USER_MAX_CHUNKS];
+static int userCount = 0;
+static size_t heapBytes = 0;   // long names and sequence tables
+
+user_t * user_new(const char * username) {
+    int chunk = userCount / USER_CHUNK;
+    if (chunk >= USER_MAX_CHUNKS) {
+        return NULL;
+    }
+    if (chunks[chunk] == NULL) {
+        chunks[chunk] = calloc(1, sizeof(user_chunk_t));
+    }
+
+    user_t * user = &chunks[chunk]->hot[userCount % USER_CHUNK];
+    user->id = userCount;
+    size_t len = strlen(username);
+    if (len < USER_NAME_INLINE) {
+        memcpy(user->name, username, len + 1);
+        user->username = user->name;
+    } else {
+        user->username = strdup(username);
+        heapBytes += len + 1;
+    }
+    userCount++;
+    return user;
+}
+
+user_cold_t * user_cold(const user_t * user) {
+    return &chunks[user->id / USER_CHUNK]->cold[user->id % USER_CHUNK];
+}
+
+void user_set_wait_seq(user_t * user, int course, uint32_t seq) {
+    user_cold_t * cold = user_cold(user);
+    uint32_t entry = ((uint32_t)course << WAIT_SEQ_BITS) | (seq & WAIT_SEQ_MASK);
+    for (int i = 0; i < cold->waitCnt; ++i) {
+        if (cold->waitSeq[i] >> WAIT_SEQ_BITS == (uint32_t)course) {
+            cold->waitSeq[i] = entry;
+            return;
+        }
+    }
+    if (cold->waitCnt == cold->waitCap) {
+        heapBytes += cold->waitCap ? cold->waitCap * sizeof(uint32_t) : 2 * sizeof(uint32_t);
+        cold->waitCap = cold->waitCap ? cold->waitCap * 2 : 2;
+        cold->waitSeq = realloc(cold->waitSeq, cold->waitCap * sizeof(uint32_t));
+    }
+    cold->waitSeq[cold->waitCnt++] = entry;
+}
+
+uint32_t user_wait_seq(const user_t * user, int course) {
+    user_cold_t * cold = user_cold(user);
+    for (int i = 0; i < cold->waitCnt; ++i) {
+        if (cold->waitSeq[i] >> WAIT_SEQ_BITS == (uint32_t)course) {
+            return cold->waitSeq[i] & WAIT_SEQ_MASK;
+        }
+    }
+    return 0;
+}
+
+size_t userstore_bytes(int * count, int * slots, size_t * heap) {
+    int chunkCnt = (userCount + USER_CHUNK - 1) / USER_CHUNK;
+    *count = userCount;
+    *slots = chunkCnt * USER_CHUNK;
+    *heap = heapBytes;
+    return (size_t)chunkCnt * sizeof(user_chunk_t) + heapBytes;
+}
@@ -0,0 +1,214 @@
+#include "vector.h"
+#include <string.h>
+/*
+    What is a vector?
+    Here it is one malloc'd array of element pointers used as a ring, so
+    elements can be added and removed at both ends without moving the
+    rest. Walking it touches consecutive memory instead of chasing one
+    node allocation per element like list_t does.
+
+                 head                   head + length
+                  |                           |
+    -------------------------------------------------------
+    |      |      | DATA | DATA | DATA | DATA |      |      |
+    -------------------------------------------------------
+    When the elements run past the last slot they wrap around to slot 0.
+    Once every slot is used the array doubles and is unwrapped.
+*/
+
+#define VECTOR_MIN_CAPACITY 4
+
+vector_t* CreateVector(int (*compare)(const void*, const void*), void (*print)(void*, void*),
+                       void (*delete)(void*)) {
+    vector_t* vec = malloc(sizeof(vector_t));
+    vec->comparator = compare;
+    vec->printer = print;
+    vec->deleter = delete;
+    vec->head = 0;
+    vec->length = 0;
+    vec->capacity = VECTOR_MIN_CAPACITY;
+    vec->data = malloc(vec->capacity * sizeof(void*));
+    return vec;
+}
+
+static inline int slot(vector_t* vec, int index) {
+    return (vec->head + index) & (vec->capacity - 1);
+}
+
+//move count elements from index src to index dst, the ranges may overlap
+static void shift(vector_t* vec, int dst, int src, int count) {
+    int last = vec->head + (dst > src ? dst : src) + count;
+    if (vec->head + (dst < src ? dst : src) >= 0 && last <= vec->capacity) {
+        // neither range wraps
+        memmove(vec->data + vec->head + dst, vec->data + vec->head + src, count * sizeof(void*));
+    } else if (dst < src) {
+        for (int i = 0; i < count; ++i) {
+            vec->data[slot(vec, dst + i)] = vec->data[slot(vec, src + i)];
+        }
+    } else {
+        for (int i = count - 1; i >= 0; --i) {
+            vec->data[slot(vec, dst + i)] = vec->data[slot(vec, src + i)];
+        }
+    }
+}
+
+//double the array, moving the elements to the start of the new one
+static void grow(vector_t* vec) {
+    void** data = malloc(2 * vec->capacity * sizeof(void*));
+    int first = vec->capacity - vec->head;
+    if (first > vec->length) {
+        first = vec->length;
+    }
+    memcpy(data, vec->data + vec->head, first * sizeof(void*));
+    memcpy(data + first, vec->data, (vec->length - first) * sizeof(void*));
+    free(vec->data);
+    vec->data = data;
+    vec->head = 0;
+    vec->capacity *= 2;
+}
+
+void PushFront(vector_t* vec, void* val_ref) {
+    if (vec == NULL || val_ref == NULL)
+        return;
+    if (vec->length == vec->capacity)
+        grow(vec);
+
+    vec->head = (vec->head - 1) & (vec->capacity - 1);
+    vec->data[vec->head] = val_ref;
+    vec->length++;
+}
+
+void PushBack(vector_t* vec, void* val_ref) {
+    if (vec == NULL || val_ref == NULL)
+        return;
+    if (vec->length == vec->capacity)
+        grow(vec);
+
+    vec->data[slot(vec, vec->length)] = val_ref;
+    vec->length++;
+}
+
+void* PopFront(vector_t* vec) {
+    if (vec->length == 0) {
+        return NULL;
+    }
+
+    void* retval = vec->data[vec->head];
+    vec->head = slot(vec, 1);
+    vec->length--;
+    return retval;
+}
+
+void* PopBack(vector_t* vec) {
+    if (vec->length == 0) {
+        return NULL;
+    }
+
+    vec->length--;
+    return vec->data[slot(vec, vec->length)];
+}
+
+/* indexed by 0 */
+void* RemoveAt(vector_t* vec, int index) {
+    if (index < 0 || vec->length <= index) {
+        return NULL;
+    }
+
+    void* retval = VectorAt(vec, index);
+    // close the gap from whichever end is nearer
+    if (index < vec->length / 2) {
+        shift(vec, 1, 0, index);
+        vec->head = slot(vec, 1);
+    } else {
+        shift(vec, index, index + 1, vec->length - index - 1);
+    }
+    vec->length--;
+    return retval;
+}
+
+void* SwapRemove(vector_t* vec, int index) {
+    if (index < 0 || vec->length <= index) {
+        return NULL;
+    }
+
+    void* retval = VectorAt(vec, index);
+    vec->length--;
+    vec->data[slot(vec, index)] = vec->data[slot(vec, vec->length)];
+    return retval;
+}
+
+int IndexOf(vector_t* vec, void* val_ref) {
+    for (int i = 0; i < vec->length; ++i) {
+        if (VectorAt(vec, i) == val_ref) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//first index whose element compares greater than key
+static int upper_bound(vector_t* vec, const void* key) {
+    int lo = 0, hi = vec->length;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (vec->comparator(key, VectorAt(vec, mid)) < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void InsertSorted(vector_t* vec, void* val_ref) {
+    if (vec == NULL || val_ref == NULL)
+        return;
+
+    // open the gap from whichever end is nearer
+    int index = upper_bound(vec, val_ref);
+    if (index < vec->length / 2) {
+        PushFront(vec, val_ref);
+        shift(vec, 0, 1, index);
+    } else {
+        PushBack(vec, val_ref);
+        shift(vec, index + 1, index, vec->length - index - 1);
+    }
+    vec->data[slot(vec, index)] = val_ref;
+}
+
+int FindSorted(vector_t* vec, const void* key) {
+    int lo = 0, hi = vec->length - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int cmp = vec->comparator(key, VectorAt(vec, mid));
+        if (cmp == 0) {
+            return mid;
+        }
+        if (cmp < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return -1;
+}
+
+void DeleteVector(vector_t* vec) {
+    if (vec->deleter != NULL) {
+        for (int i = 0; i < vec->length; ++i) {
+            vec->deleter(VectorAt(vec, i));
+        }
+    }
+    vec->head = 0;
+    vec->length = 0;
+}
+
+void PrintVector(vector_t* vec, FILE* fp) {
+    if (vec == NULL)
+        return;
+
+    for (int i = 0; i < vec->length; ++i) {
+        vec->printer(VectorAt(vec, i), fp);
+        fprintf(fp, "\n");
+    }
+}
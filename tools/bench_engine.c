@@ -0,0 +1,198 @@
+#include "engine.h"
+#include <getopt.h>
+#include <math.h>
+#include <unistd.h>
+
+#define USAGE_MSG "./bin/zotReg_enginebench [-h] [-t THREADS] [-u USERS] [-k COURSES] [-C CAPACITY] [-z SKEW] [-d SECONDS] [-l LOG_FILENAME]"\
+                  "\n  -h                 Displays this help menu and returns EXIT_SUCCESS."\
+                  "\n  -t THREADS         Threads calling into the engine (default 4)."\
+                  "\n  -u USERS           Sessions per thread, each its own user (default 1000)."\
+                  "\n  -k COURSES         Courses in the generated catalog, at most 32 (default 32)."\
+                  "\n  -C CAPACITY        Seats per course (default 50)."\
+                  "\n  -z SKEW            Zipf exponent of course popularity, 0 for uniform (default 0.99)."\
+                  "\n  -d SECONDS         How long to run (default 3)."\
+                  "\n  -l LOG_FILENAME    Where the engine writes its log (default /dev/null)."\
+                  "\nDrives the registration engine directly, without sockets: every thread loops over its"\
+                  "\nsessions sending ENROLL, DROP, WAIT, SCHED and CLIST for zipf distributed courses.\n"
+
+static int threads = 4;
+static int users = 1000;
+static int courses = 32;
+static int capacity = 50;
+static double skew = 0.99;
+static int seconds = 3;
+static const char * log_name = "/dev/null";
+
+static double cdf[32];
+static volatile int stop = 0;
+
+typedef struct {
+    int id;
+    long ops[256];   // by request type
+} worker_t;
+
+//course index with probability proportional to 1 / (rank + 1)^skew
+static int zipf_course(unsigned * seed) {
+    double u = rand_r(seed) / ((double)RAND_MAX + 1);
+    int lo = 0, hi = courses - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cdf[mid] > u) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+static uint8_t next_type(unsigned * seed) {
+    int r = rand_r(seed) % 100;
+    if (r < 35) {
+        return ENROLL;
+    } else if (r < 60) {
+        return DROP;
+    } else if (r < 70) {
+        return WAIT;
+    } else if (r < 90) {
+        return SCHED;
+    }
+    return CLIST;
+}
+
+static void * worker(void * arg) {
+    worker_t * w = arg;
+    session_t * sessions = calloc(users, sizeof(session_t));
+    for (int i = 0; i < users; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "eng%d_%d", w->id, i);
+        session_init(&sessions[i], login_user(-1, name), -1);
+    }
+
+    unsigned seed = w->id * 7919 + 1;
+    char body[16];
+    while (!stop) {
+        for (int i = 0; i < users && !stop; ++i) {
+            session_t * session = &sessions[i];
+            petrV_header h;
+            h.msg_type = next_type(&seed);
+            snprintf(body, sizeof(body), "%d", zipf_course(&seed));
+            h.msg_len = strlen(body) + 1;
+            session->arrived = overload_clock();
+            handle_request(session, &h, body);
+            session->outLen = 0;
+            w->ops[h.msg_type]++;
+        }
+    }
+
+    for (int i = 0; i < users; ++i) {
+        session_release(&sessions[i]);
+    }
+    free(sessions);
+    return NULL;
+}
+
+static void print_lock(const char * name, lock_stats_t * stats, long total) {
+    long contended = atomic_load(&stats->contended);
+    long wait_ns = atomic_load(&stats->waitNs);
+    printf("  %-8s %10ld contended (%.2f%% of requests), %.1f ms waiting, %.2f us per wait\n", name, contended,
+           total ? 100.0 * contended / total : 0, wait_ns / 1e6, contended ? wait_ns / 1e3 / contended : 0);
+}
+
+int main(int argc, char * argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "ht:u:k:C:z:d:l:")) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_SUCCESS);
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'u':
+                users = atoi(optarg);
+                break;
+            case 'k':
+                courses = atoi(optarg);
+                break;
+            case 'C':
+                capacity = atoi(optarg);
+                break;
+            case 'z':
+                skew = atof(optarg);
+                break;
+            case 'd':
+                seconds = atoi(optarg);
+                break;
+            case 'l':
+                log_name = optarg;
+                break;
+            default:
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (threads <= 0 || users <= 0 || courses <= 0 || courses > 32 || capacity <= 0 || seconds <= 0) {
+        fprintf(stderr, USAGE_MSG);
+        exit(EXIT_FAILURE);
+    }
+
+    // catalog of identical courses, only their popularity differs
+    char course_name[] = "/tmp/zotReg_courses_XXXXXX";
+    int fd = mkstemp(course_name);
+    FILE * f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (f == NULL) {
+        printf("ERROR: Could not create course file\n");
+        exit(2);
+    }
+    for (int i = 0; i < courses; ++i) {
+        fprintf(f, "Course %d;%d\n", i, capacity);
+    }
+    fclose(f);
+
+    double sum = 0;
+    for (int i = 0; i < courses; ++i) {
+        sum += 1.0 / pow(i + 1, skew);
+        cdf[i] = sum;
+    }
+    for (int i = 0; i < courses; ++i) {
+        cdf[i] /= sum;
+    }
+
+    // no shedding, every request runs
+    queue_depth = 0;
+    delay_target_ms = 0;
+    engine_init(course_name, log_name);
+    unlink(course_name);
+
+    worker_t * workers = calloc(threads, sizeof(worker_t));
+    pthread_t * tids = calloc(threads, sizeof(pthread_t));
+    uint64_t start = trace_clock();
+    for (int i = 0; i < threads; ++i) {
+        workers[i].id = i;
+        pthread_create(&tids[i], NULL, worker, &workers[i]);
+    }
+    sleep(seconds);
+    stop = 1;
+
+    long ops[256] = {0};
+    long total = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+        for (int t = 0; t < 256; ++t) {
+            ops[t] += workers[i].ops[t];
+            total += workers[i].ops[t];
+        }
+    }
+    double secs = (trace_clock() - start) / 1e9;
+
+    printf("%d threads x %d users, %d courses of %d seats, zipf %.2f: %ld requests in %.3f s, %.0f ops/s\n",
+           threads, users, courses, capacity, skew, total, secs, total / secs);
+    printf("  ENROLL %ld, DROP %ld, WAIT %ld, SCHED %ld, CLIST %ld\n", ops[ENROLL], ops[DROP], ops[WAIT],
+           ops[SCHED], ops[CLIST]);
+    printf("lock contention:\n");
+    print_lock("courses", &courseLockStats, total);
+    print_lock("log", &logLockStats, total);
+    print_lock("users", &userLockStats, total);
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include "protocol.h"
+#include <errno.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define USAGE_MSG "./bin/zotReg_bench [-h] [-c CONNS] [-n REQUESTS] [-d DEPTH] [-k COURSES] HOST PORT"\
+                  "\n  -h                 Displays this help menu and returns EXIT_SUCCESS."\
+                  "\n  -c CONNS           Concurrent client connections, each logged in as its own user (default 16)."\
+                  "\n  -n REQUESTS        Requests sent per connection (default 10000)."\
+                  "\n  -d DEPTH           Requests each connection keeps in flight (default 1)."\
+                  "\n  -k COURSES         Courses to spread ENROLL/DROP over (default 3)."\
+                  "\n  HOST               Host the server is listening on."\
+                  "\n  PORT               Port the server is listening on."\
+                  "\nEvery connection runs the same closed-loop mix of CLIST, SCHED, ENROLL and DROP, so runs"\
+                  "\nagainst different -b backends of the server are directly comparable.\n"
+
+static char* host;
+static char* port;
+static int conns = 16;
+static int requests = 10000;
+static int depth = 1;
+static int courses = 3;
+
+typedef struct {
+    int id;
+    uint64_t* lat;
+    int done;
+    int failed;
+} worker_t;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int connect_server() {
+    struct addrinfo hints = {0}, *res;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0)
+        return -1;
+
+    int fd = socket(res->ai_family, res->ai_socktype, 0);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static int send_msg(int fd, uint8_t type, const char* body) {
+    petrV_header h;
+    h.msg_type = type;
+    h.msg_len = strlen(body) + 1;
+    return wr_msg(fd, &h, (char*)body);
+}
+
+static int read_reply(int fd) {
+    petrV_header h;
+    if (rd_msgheader(fd, &h) != 0)
+        return -1;
+    char buf[1024];
+    uint32_t left = h.msg_len;
+    while (left > 0) {
+        ssize_t n = read(fd, buf, left < sizeof(buf) ? left : sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        left -= n;
+    }
+    return h.msg_type;
+}
+
+static void next_request(unsigned* seed, uint8_t* type, char* body) {
+    int r = rand_r(seed) % 100;
+    snprintf(body, 16, "%d", rand_r(seed) % courses);
+    if (r < 40) {
+        *type = CLIST;
+        body[0] = '\0';
+    } else if (r < 70) {
+        *type = SCHED;
+        body[0] = '\0';
+    } else if (r < 85) {
+        *type = ENROLL;
+    } else {
+        *type = DROP;
+    }
+}
+
+static void* worker(void* arg) {
+    worker_t* w = arg;
+    char name[32];
+    snprintf(name, sizeof(name), "bench%d", w->id);
+
+    int fd = connect_server();
+    if (fd < 0 || send_msg(fd, LOGIN, name) < 0 || read_reply(fd) != OK) {
+        w->failed = requests;
+        return NULL;
+    }
+
+    unsigned seed = w->id * 7919 + 1;
+    uint64_t* sent = malloc(depth * sizeof(uint64_t));
+    int issued = 0;
+    while (w->done + w->failed < requests) {
+        // keep up to depth requests in flight, replies come back in order
+        while (issued < requests && issued - w->done - w->failed < depth) {
+            uint8_t type;
+            char body[16];
+            next_request(&seed, &type, body);
+            sent[issued % depth] = now_ns();
+            if (send_msg(fd, type, body) < 0) {
+                w->failed = requests - w->done;
+                break;
+            }
+            issued++;
+        }
+        if (w->done + w->failed >= requests)
+            break;
+
+        int i = w->done + w->failed;
+        if (read_reply(fd) < 0) {
+            w->failed = requests - w->done;
+            break;
+        }
+        w->lat[w->done++] = now_ns() - sent[i % depth];
+    }
+
+    send_msg(fd, LOGOUT, "");
+    read_reply(fd);
+    close(fd);
+    free(sent);
+    return NULL;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "hc:n:d:k:")) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_SUCCESS);
+            case 'c':
+                conns = atoi(optarg);
+                break;
+            case 'n':
+                requests = atoi(optarg);
+                break;
+            case 'd':
+                depth = atoi(optarg);
+                break;
+            case 'k':
+                courses = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (argc - optind != 2 || conns <= 0 || requests <= 0 || depth <= 0 || courses <= 0) {
+        fprintf(stderr, USAGE_MSG);
+        exit(EXIT_FAILURE);
+    }
+    host = argv[optind];
+    port = argv[optind + 1];
+    signal(SIGPIPE, SIG_IGN);
+
+    worker_t* workers = calloc(conns, sizeof(worker_t));
+    pthread_t* tids = calloc(conns, sizeof(pthread_t));
+    uint64_t start = now_ns();
+    for (int i = 0; i < conns; ++i) {
+        workers[i].id = i;
+        workers[i].lat = malloc(requests * sizeof(uint64_t));
+        pthread_create(&tids[i], NULL, worker, &workers[i]);
+    }
+
+    long total = 0, failed = 0;
+    for (int i = 0; i < conns; ++i) {
+        pthread_join(tids[i], NULL);
+        total += workers[i].done;
+        failed += workers[i].failed;
+    }
+    double secs = (now_ns() - start) / 1e9;
+
+    uint64_t* lat = malloc((total ? total : 1) * sizeof(uint64_t));
+    long n = 0;
+    for (int i = 0; i < conns; ++i) {
+        memcpy(lat + n, workers[i].lat, workers[i].done * sizeof(uint64_t));
+        n += workers[i].done;
+    }
+    qsort(lat, n, sizeof(uint64_t), cmp_u64);
+
+    printf("%d conns x %d requests, depth %d: %ld ok, %ld failed in %.3f s, %.0f req/s\n", conns, requests, depth,
+           total, failed, secs, total / secs);
+    if (n > 0) {
+        printf("latency us: p50 %.1f, p99 %.1f, max %.1f\n", lat[n / 2] / 1e3, lat[(long)(n * 0.99)] / 1e3,
+               lat[n - 1] / 1e3);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+#define _GNU_SOURCE
+#include "protocol.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define USAGE_MSG "./bin/zotReg_pinbench [-h] [-s SERVER] [-b BACKEND] [-P CPU_LIST] [-C CLIENT_CPUS] [-c CONNS] [-n REQUESTS] [-k COURSES] [-r RUNS] [-p PORT]"\
+                  "\n  -h                 Displays this help menu and returns EXIT_SUCCESS."\
+                  "\n  -s SERVER          Server binary to start (default ./bin/zotReg_server)."\
+                  "\n  -b BACKEND         Server backend, blocking, epoll or uring (default epoll)."\
+                  "\n  -P CPU_LIST        CPUs the pinned server runs on, passed as its -P (default: every online CPU)."\
+                  "\n  -C CLIENT_CPUS     Pin the load threads to these CPUs, keep them off -P for a fair run (default: floating)."\
+                  "\n  -c CONNS           Concurrent client connections, each logged in as its own user (default 64)."\
+                  "\n  -n REQUESTS        Requests sent per connection (default 20000)."\
+                  "\n  -k COURSES         Courses in the generated catalog, ENROLL/DROP spread over them (default 32)."\
+                  "\n  -r RUNS            Runs of each configuration, alternating (default 3)."\
+                  "\n  -p PORT            Port the server is started on (default 23456)."\
+                  "\nStarts the server without -P and with -P CPU_LIST in turn and drives each with the same"\
+                  "\nclosed-loop mix of CLIST, SCHED, ENROLL and DROP, then compares median throughput.\n"
+
+static char* server = "./bin/zotReg_server";
+static char* backend = "epoll";
+static char* pin_list = NULL;
+static char* client_cpus = NULL;
+static int conns = 64;
+static int requests = 20000;
+static int courses = 32;
+static int runs = 3;
+static char port[16] = "23456";
+static char course_file[] = "/tmp/zotReg_pinbench_XXXXXX";
+
+typedef struct {
+    int id;
+    int done;
+    int failed;
+} worker_t;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+//"0-3,6" into a cpu set, -1 if malformed
+static int parse_cpus(const char* list, cpu_set_t* set) {
+    CPU_ZERO(set);
+    const char* p = list;
+    while (*p != '\0') {
+        char* end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end == p)
+            return -1;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p)
+                return -1;
+        }
+        if (lo < 0 || hi < lo || hi >= CPU_SETSIZE)
+            return -1;
+        for (long cpu = lo; cpu <= hi; ++cpu)
+            CPU_SET(cpu, set);
+        if (*end == ',')
+            end++;
+        else if (*end != '\0')
+            return -1;
+        p = end;
+    }
+    return 0;
+}
+
+static int connect_server() {
+    struct addrinfo hints = {0}, *res;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo("127.0.0.1", port, &hints, &res) != 0)
+        return -1;
+
+    int fd = socket(res->ai_family, res->ai_socktype, 0);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static int send_msg(int fd, uint8_t type, const char* body) {
+    petrV_header h;
+    h.msg_type = type;
+    h.msg_len = strlen(body) + 1;
+    return wr_msg(fd, &h, (char*)body);
+}
+
+static int read_reply(int fd) {
+    petrV_header h;
+    if (rd_msgheader(fd, &h) != 0)
+        return -1;
+    char buf[1024];
+    uint32_t left = h.msg_len;
+    while (left > 0) {
+        ssize_t n = read(fd, buf, left < sizeof(buf) ? left : sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        left -= n;
+    }
+    return h.msg_type;
+}
+
+static void* worker(void* arg) {
+    worker_t* w = arg;
+    if (client_cpus != NULL) {
+        cpu_set_t set;
+        parse_cpus(client_cpus, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "pin%d", w->id);
+    int fd = connect_server();
+    if (fd < 0 || send_msg(fd, LOGIN, name) < 0 || read_reply(fd) != OK) {
+        w->failed = requests;
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+
+    unsigned seed = w->id * 7919 + 1;
+    while (w->done + w->failed < requests) {
+        char body[16];
+        uint8_t type;
+        int r = rand_r(&seed) % 100;
+        snprintf(body, sizeof(body), "%d", rand_r(&seed) % courses);
+        if (r < 40) {
+            type = CLIST;
+            body[0] = '\0';
+        } else if (r < 70) {
+            type = SCHED;
+            body[0] = '\0';
+        } else if (r < 85) {
+            type = ENROLL;
+        } else {
+            type = DROP;
+        }
+        if (send_msg(fd, type, body) < 0 || read_reply(fd) < 0) {
+            w->failed = requests - w->done;
+            break;
+        }
+        w->done++;
+    }
+
+    send_msg(fd, LOGOUT, "");
+    read_reply(fd);
+    close(fd);
+    return NULL;
+}
+
+static pid_t start_server(const char* pins) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        // no shedding, every request is served
+        if (pins != NULL)
+            execl(server, server, "-b", backend, "-q", "0", "-D", "0", "-P", pins, port, course_file, "/dev/null",
+                  (char*)NULL);
+        else
+            execl(server, server, "-b", backend, "-q", "0", "-D", "0", port, course_file, "/dev/null", (char*)NULL);
+        _exit(127);
+    }
+
+    // up once it answers a LOGIN, the blocking acceptor stops on a connection that sends nothing
+    for (int i = 0; i < 200; ++i) {
+        usleep(10000);
+        int fd = connect_server();
+        if (fd >= 0) {
+            int ok = send_msg(fd, LOGIN, "probe") == 0 && read_reply(fd) == OK;
+            send_msg(fd, LOGOUT, "");
+            read_reply(fd);
+            close(fd);
+            if (ok)
+                return pid;
+        }
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+            break;
+    }
+    printf("ERROR: Could not start %s\n", server);
+    kill(pid, SIGKILL);
+    exit(2);
+}
+
+static void stop_server(pid_t pid) {
+    kill(pid, SIGINT);
+    for (int i = 0; i < 200; ++i) {
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+            return;
+        usleep(10000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+//one run against a fresh server, returns requests per second
+static double run(const char* pins) {
+    pid_t pid = start_server(pins);
+
+    worker_t* workers = calloc(conns, sizeof(worker_t));
+    pthread_t* tids = calloc(conns, sizeof(pthread_t));
+    uint64_t start = now_ns();
+    for (int i = 0; i < conns; ++i) {
+        workers[i].id = i;
+        pthread_create(&tids[i], NULL, worker, &workers[i]);
+    }
+    long total = 0, failed = 0;
+    for (int i = 0; i < conns; ++i) {
+        pthread_join(tids[i], NULL);
+        total += workers[i].done;
+        failed += workers[i].failed;
+    }
+    double secs = (now_ns() - start) / 1e9;
+    stop_server(pid);
+
+    printf("  %-10s %ld ok, %ld failed in %.3f s, %.0f req/s\n", pins ? "pinned" : "unpinned", total, failed, secs,
+           total / secs);
+    free(workers);
+    free(tids);
+    return total / secs;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    cpu_set_t set;
+    while ((opt = getopt(argc, argv, "hs:b:P:C:c:n:k:r:p:")) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_SUCCESS);
+            case 's':
+                server = optarg;
+                break;
+            case 'b':
+                backend = optarg;
+                break;
+            case 'P':
+                pin_list = optarg;
+                break;
+            case 'C':
+                client_cpus = optarg;
+                break;
+            case 'c':
+                conns = atoi(optarg);
+                break;
+            case 'n':
+                requests = atoi(optarg);
+                break;
+            case 'k':
+                courses = atoi(optarg);
+                break;
+            case 'r':
+                runs = atoi(optarg);
+                break;
+            case 'p':
+                snprintf(port, sizeof(port), "%s", optarg);
+                break;
+            default:
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (argc != optind || conns <= 0 || requests <= 0 || courses <= 0 || courses > 32 || runs <= 0 ||
+        (pin_list != NULL && parse_cpus(pin_list, &set) != 0) ||
+        (client_cpus != NULL && parse_cpus(client_cpus, &set) != 0)) {
+        fprintf(stderr, USAGE_MSG);
+        exit(EXIT_FAILURE);
+    }
+    char all[32];
+    if (pin_list == NULL) {
+        snprintf(all, sizeof(all), "0-%ld", sysconf(_SC_NPROCESSORS_ONLN) - 1);
+        pin_list = all;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    // roomy courses so ENROLL mostly succeeds and keeps the course locks busy
+    int fd = mkstemp(course_file);
+    FILE* f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (f == NULL) {
+        printf("ERROR: Could not create course file\n");
+        exit(2);
+    }
+    for (int i = 0; i < courses; ++i)
+        fprintf(f, "Course %d;%d\n", i, conns);
+    fclose(f);
+
+    printf("%s backend, %d conns x %d requests, %d courses, pinned to %s, load %s\n", backend, conns, requests,
+           courses, pin_list, client_cpus ? client_cpus : "floating");
+    double* unpinned = malloc(runs * sizeof(double));
+    double* pinned = malloc(runs * sizeof(double));
+    for (int i = 0; i < runs; ++i) {
+        unpinned[i] = run(NULL);
+        pinned[i] = run(pin_list);
+    }
+    unlink(course_file);
+
+    qsort(unpinned, runs, sizeof(double), cmp_double);
+    qsort(pinned, runs, sizeof(double), cmp_double);
+    double u = unpinned[runs / 2], p = pinned[runs / 2];
+    printf("median: unpinned %.0f req/s, pinned %.0f req/s (%+.1f%%)\n", u, p, u > 0 ? 100.0 * (p - u) / u : 0);
+    return 0;
+}
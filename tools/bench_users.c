@@ -0,0 +1,212 @@
+#include "protocol.h"
+#include <errno.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define USAGE_MSG "./bin/zotReg_userbench [-h] [-u USERS] [-e ENROLLS] [-k COURSES] [-c CONNS] [-p PID] HOST PORT"\
+                  "\n  -h                 Displays this help menu and returns EXIT_SUCCESS."\
+                  "\n  -u USERS           Distinct users to log in (default 100000)."\
+                  "\n  -e ENROLLS         Courses each user ENROLLs in, or WAITs for when full (default 2)."\
+                  "\n  -k COURSES         Courses to spread them over (default 3)."\
+                  "\n  -c CONNS           Users logging in at once (default 4)."\
+                  "\n  -p PID             Server process, its RSS is sampled every tenth of the users."\
+                  "\n  HOST               Host the server is listening on."\
+                  "\n  PORT               Port the server is listening on."\
+                  "\nEvery user logs in once, registers and logs out, so the server ends up holding USERS users"\
+                  "\nand USERS * ENROLLS roster entries. The server's STATS memory report is printed at the end.\n"
+
+static char* host;
+static char* port;
+static int users = 100000;
+static int enrolls = 2;
+static int courses = 3;
+static int conns = 4;
+static int pid = 0;
+
+static pthread_mutex_t next_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int next_user = 0;
+static int failed = 0;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int connect_server() {
+    struct addrinfo hints = {0}, *res;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0)
+        return -1;
+
+    int fd = socket(res->ai_family, res->ai_socktype, 0);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+
+    // reset on close, a hundred thousand TIME_WAIT sockets would run out of ports
+    struct linger lin = {1, 0};
+    if (fd >= 0)
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+    return fd;
+}
+
+static int request(int fd, uint8_t type, const char* body) {
+    petrV_header h;
+    h.msg_type = type;
+    h.msg_len = strlen(body) + 1;
+    if (wr_msg(fd, &h, (char*)body) < 0 || rd_msgheader(fd, &h) != 0)
+        return -1;
+    char buf[1024];
+    uint32_t left = h.msg_len;
+    while (left > 0) {
+        ssize_t n = read(fd, buf, left < sizeof(buf) ? left : sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        left -= n;
+    }
+    return h.msg_type;
+}
+
+// server resident set in KB, 0 if unknown
+static long server_rss() {
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return 0;
+    long kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmRSS: %ld", &kb) == 1)
+            break;
+    }
+    fclose(f);
+    return kb;
+}
+
+static int register_user(int id) {
+    char name[32], body[16];
+    snprintf(name, sizeof(name), "stu%d", id);
+    int fd = connect_server();
+    if (fd < 0)
+        return -1;
+    int rc = request(fd, LOGIN, name) == OK ? 0 : -1;
+    for (int i = 0; rc == 0 && i < enrolls && i < courses; ++i) {
+        snprintf(body, sizeof(body), "%d", (id + i) % courses);
+        int reply = request(fd, ENROLL, body);
+        if (reply == ECDENIED)
+            reply = request(fd, WAIT, body);
+        if (reply < 0)
+            rc = -1;
+    }
+    if (rc == 0)
+        request(fd, LOGOUT, "");
+    close(fd);
+    return rc;
+}
+
+static void* worker(void* arg) {
+    while (1) {
+        pthread_mutex_lock(&next_mutex);
+        int id = next_user < users ? next_user++ : -1;
+        pthread_mutex_unlock(&next_mutex);
+        if (id < 0)
+            return NULL;
+
+        if (register_user(id) != 0) {
+            pthread_mutex_lock(&next_mutex);
+            failed++;
+            pthread_mutex_unlock(&next_mutex);
+        }
+        // the user that finishes each tenth samples the server
+        if (pid > 0 && (id + 1) % (users / 10 ? users / 10 : 1) == 0) {
+            printf("%8d users: server RSS %ld KB\n", id + 1, server_rss());
+            fflush(stdout);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "hu:e:k:c:p:")) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_SUCCESS);
+            case 'u':
+                users = atoi(optarg);
+                break;
+            case 'e':
+                enrolls = atoi(optarg);
+                break;
+            case 'k':
+                courses = atoi(optarg);
+                break;
+            case 'c':
+                conns = atoi(optarg);
+                break;
+            case 'p':
+                pid = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (argc - optind != 2 || users <= 0 || enrolls < 0 || courses <= 0 || conns <= 0) {
+        fprintf(stderr, USAGE_MSG);
+        exit(EXIT_FAILURE);
+    }
+    host = argv[optind];
+    port = argv[optind + 1];
+    signal(SIGPIPE, SIG_IGN);
+
+    long rss_before = pid > 0 ? server_rss() : 0;
+    uint64_t start = now_ns();
+    pthread_t* tids = calloc(conns, sizeof(pthread_t));
+    for (int i = 0; i < conns; ++i)
+        pthread_create(&tids[i], NULL, worker, NULL);
+    for (int i = 0; i < conns; ++i)
+        pthread_join(tids[i], NULL);
+    double secs = (now_ns() - start) / 1e9;
+
+    printf("%d users x %d registrations: %d failed in %.3f s\n", users, enrolls, failed, secs);
+    if (pid > 0) {
+        long rss = server_rss();
+        printf("server RSS %ld KB -> %ld KB, %.1f B/user\n", rss_before, rss, (rss - rss_before) * 1024.0 / users);
+    }
+
+    // the server's own accounting
+    int fd = connect_server();
+    petrV_header h;
+    if (fd >= 0 && request(fd, LOGIN, "userbench") == OK) {
+        h.msg_type = STATS;
+        h.msg_len = 1;
+        if (wr_msg(fd, &h, "") >= 0 && rd_msgheader(fd, &h) == 0 && h.msg_type == STATS) {
+            char* reply = calloc(1, h.msg_len + 1);
+            uint32_t got = 0;
+            ssize_t n;
+            while (got < h.msg_len && (n = read(fd, reply + got, h.msg_len - got)) > 0)
+                got += n;
+            printf("%s", reply);
+            free(reply);
+        }
+        request(fd, LOGOUT, "");
+    }
+    if (fd >= 0)
+        close(fd);
+    return failed ? 1 : 0;
+}
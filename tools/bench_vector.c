@@ -0,0 +1,149 @@
+#include "linkedlist.h"
+#include "vector.h"
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+
+#define USAGE_MSG "./bin/zotReg_vecbench [-h] [-n ELEMENTS]"\
+                  "\n  -h                 Displays this help menu and returns EXIT_SUCCESS."\
+                  "\n  -n ELEMENTS        Elements per run (default 10000)."\
+                  "\nTimes list_t against vector_t on the operations the server does on course"\
+                  "\nrosters, waitlists and userList.\n"
+
+static int n = 10000;
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int str_comparator(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+static void report(const char* what, double list_ms, double vec_ms) {
+    printf("%-32s list %10.2f ms   vector %8.2f ms   %7.1fx\n", what, list_ms, vec_ms,
+           vec_ms > 0 ? list_ms / vec_ms : 0);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "hn:")) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_SUCCESS);
+            case 'n':
+                n = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (n <= 0) {
+        fprintf(stderr, USAGE_MSG);
+        exit(EXIT_FAILURE);
+    }
+
+    // usernames in a shuffled order, the way students log in
+    char** names = malloc(n * sizeof(char*));
+    for (int i = 0; i < n; ++i) {
+        names[i] = malloc(16);
+        snprintf(names[i], 16, "user%07d", i);
+    }
+    srand(1);
+    for (int i = n - 1; i > 0; --i) {
+        int j = rand() % (i + 1);
+        char* tmp = names[i];
+        names[i] = names[j];
+        names[j] = tmp;
+    }
+
+    // waitlist: join at the tail, promoted from the head
+    list_t* list = CreateList(str_comparator, NULL, NULL);
+    double t = now_ms();
+    for (int i = 0; i < n; ++i)
+        InsertAtTail(list, names[i]);
+    double list_ms = now_ms() - t;
+    vector_t* vec = CreateVector(str_comparator, NULL, NULL);
+    t = now_ms();
+    for (int i = 0; i < n; ++i)
+        PushBack(vec, names[i]);
+    report("append (InsertAtTail/PushBack)", list_ms, now_ms() - t);
+
+    t = now_ms();
+    for (int i = 0; i < n; ++i)
+        RemoveFromHead(list);
+    list_ms = now_ms() - t;
+    t = now_ms();
+    for (int i = 0; i < n; ++i)
+        PopFront(vec);
+    report("pop front", list_ms, now_ms() - t);
+
+    // roster: DROP looks the student up by name and removes them in place
+    for (int i = 0; i < n; ++i) {
+        InsertAtTail(list, names[i]);
+        PushBack(vec, names[i]);
+    }
+    t = now_ms();
+    for (int i = 0; i < n; ++i) {
+        int index = 0;
+        node_t* curr = list->head;
+        while (curr != NULL && strcmp(curr->data, names[(i * 7919) % n]) != 0) {
+            curr = curr->next;
+            index++;
+        }
+        RemoveByIndex(list, index);
+        InsertAtTail(list, names[(i * 7919) % n]);
+    }
+    list_ms = now_ms() - t;
+    t = now_ms();
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < vec->length; ++j) {
+            if (strcmp(VectorAt(vec, j), names[(i * 7919) % n]) == 0) {
+                RemoveAt(vec, j);
+                break;
+            }
+        }
+        PushBack(vec, names[(i * 7919) % n]);
+    }
+    report("find + remove + re-add", list_ms, now_ms() - t);
+    while (RemoveFromHead(list) != NULL)
+        ;
+    while (PopFront(vec) != NULL)
+        ;
+
+    // userList: sorted insert at login, then lookups by name on every request
+    t = now_ms();
+    for (int i = 0; i < n; ++i)
+        InsertInOrder(list, names[i]);
+    list_ms = now_ms() - t;
+    t = now_ms();
+    for (int i = 0; i < n; ++i)
+        InsertSorted(vec, names[i]);
+    report("sorted insert", list_ms, now_ms() - t);
+
+    long found = 0;
+    t = now_ms();
+    for (int i = 0; i < n; ++i) {
+        node_t* curr = list->head;
+        while (curr != NULL && strcmp(curr->data, names[i]) != 0)
+            curr = curr->next;
+        found += curr != NULL;
+    }
+    list_ms = now_ms() - t;
+    t = now_ms();
+    for (int i = 0; i < n; ++i)
+        found += FindSorted(vec, names[i]) >= 0;
+    report("lookup by name", list_ms, now_ms() - t);
+
+    for (int i = 0; i < vec->length; ++i) {
+        if (i > 0 && strcmp(VectorAt(vec, i - 1), VectorAt(vec, i)) > 0) {
+            printf("ERROR: vector is out of order at %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return found == 2L * n ? 0 : 1;
+}
@@ -0,0 +1,547 @@
+#include "protocol.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#define USAGE_MSG "./bin/zotReg_replay [-h] [-n] [-r RATE] [-p SERVER_PID] [-c DUMP_FILE] HOST PORT COURSE_FILENAME LOG_FILENAME"\
+                  "\n  -h                 Displays this help menu and returns EXIT_SUCCESS."\
+                  "\n  -n                 Do not send any requests, only derive (and check) the final state."\
+                  "\n  -r RATE            Requests per second to replay at. 0 (default) replays as fast as possible."\
+                  "\n  -p SERVER_PID      Send SIGINT to the server once the replay is done and wait for it to exit."\
+                  "\n  -c DUMP_FILE       Server STDOUT captured after SIGINT. Compared against the state implied by the log."\
+                  "\n  HOST               Host the server is listening on."\
+                  "\n  PORT               Port the server is listening on."\
+                  "\n  COURSE_FILENAME    Course file the server was started with."\
+                  "\n  LOG_FILENAME       Server log to turn into a petrV workload.\n"
+
+#define MAX_COURSES 32
+#define MAX_NAME 256
+
+/*
+ * One replayed request.
+ *
+ * user - index into the users table.
+ * type - petrV message type to send. LOGIN and LOGOUT open/close the connection.
+ * hasArg - the log line carried an argument, sent back exactly as logged
+ *          (a rejected negative index included).
+ * arg - course index for ENROLL/WAIT/DROP, k for CONTESTED.
+ * hasArg2/arg2 - course enrolled in by SWAP (arg is the one dropped).
+ * expect - message type the original server answered with.
+ */
+typedef struct {
+    int user;
+    uint8_t type;
+    int hasArg;
+    int arg;
+    int hasArg2;
+    int arg2;
+    uint8_t expect;
+} op_t;
+
+typedef struct {
+    char name[MAX_NAME];
+    int fd;
+} ruser_t;
+
+/*
+ * State of a course as implied by the log. Rosters hold indices into users,
+ * in the same order the server appends to its lists.
+ */
+typedef struct {
+    char* title;
+    int maxCap;
+    int* enrolled;
+    int enrolledCnt;
+    int* waiting;
+    int waitingCnt;
+} rcourse_t;
+
+static ruser_t* users;
+static int userCnt, userCap;
+static op_t* ops;
+static int opCnt, opCap;
+static rcourse_t courses[MAX_COURSES];
+static int courseCnt;
+static const char* courseFile;
+
+static int find_user(const char* name) {
+    for (int i = 0; i < userCnt; ++i) {
+        if (strcmp(users[i].name, name) == 0)
+            return i;
+    }
+    if (userCnt == userCap) {
+        userCap = userCap ? userCap * 2 : 64;
+        users = realloc(users, userCap * sizeof(ruser_t));
+    }
+    snprintf(users[userCnt].name, MAX_NAME, "%s", name);
+    users[userCnt].fd = -1;
+    return userCnt++;
+}
+
+static void add_op(int user, uint8_t type, int has_arg, int arg, uint8_t expect) {
+    if (opCnt == opCap) {
+        opCap = opCap ? opCap * 2 : 256;
+        ops = realloc(ops, opCap * sizeof(op_t));
+    }
+    ops[opCnt].user = user;
+    ops[opCnt].type = type;
+    ops[opCnt].hasArg = has_arg;
+    ops[opCnt].arg = arg;
+    ops[opCnt].hasArg2 = 0;
+    ops[opCnt].arg2 = -1;
+    ops[opCnt].expect = expect;
+    opCnt++;
+}
+
+static void roster_remove(int* roster, int* cnt, int user) {
+    for (int i = 0; i < *cnt; ++i) {
+        if (roster[i] == user) {
+            memmove(&roster[i], &roster[i + 1], (*cnt - i - 1) * sizeof(int));
+            (*cnt)--;
+            return;
+        }
+    }
+}
+
+static void read_courses(const char* file_name) {
+    FILE* f = fopen(file_name, "r");
+    if (!f) {
+        fprintf(stderr, "ERROR: Could not open course file\n");
+        exit(2);
+    }
+
+    // read again after a RELOAD: known courses keep their rosters, new ones are appended
+    char line[256];
+    int index = 0;
+    while (index < MAX_COURSES && fgets(line, sizeof(line), f)) {
+        char* title = strtok(line, ";");
+        char* temp = strtok(NULL, ";");
+        if (title == NULL || temp == NULL)
+            continue;
+        rcourse_t* c = &courses[index++];
+        if (index > courseCnt) {
+            courseCnt = index;
+            c->title = strdup(title);
+            c->enrolled = calloc(1, sizeof(int));
+            c->waiting = calloc(1, sizeof(int));
+        }
+        c->maxCap = atoi(temp);
+    }
+    fclose(f);
+}
+
+static void roster_append(int** roster, int* cnt, int user) {
+    *roster = realloc(*roster, (*cnt + 1) * sizeof(int));
+    (*roster)[(*cnt)++] = user;
+}
+
+/*
+ * Turn every log line into a request (or a side effect of one) and apply
+ * the successful ones to the expected course state.
+ */
+static void read_log(const char* file_name) {
+    FILE* f = fopen(file_name, "r");
+    if (!f) {
+        fprintf(stderr, "ERROR: Could not open log file\n");
+        exit(2);
+    }
+
+    char line[512];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char a[MAX_NAME], b[MAX_NAME];
+        int idx = -1;
+        lineno++;
+
+        int n = sscanf(line, "%255s %255s %d", a, b, &idx);
+        if (n < 2)
+            continue;
+        int hasIdx = n == 3;
+
+        if (strcmp(a, "CONNECTED") == 0 || strcmp(a, "RECONNECTED") == 0) {
+            add_op(find_user(b), LOGIN, 0, -1, OK);
+            continue;
+        }
+        if (strcmp(a, "REJECTED") == 0) {
+            // turned away at login by the connection limit, never got a session
+            continue;
+        }
+
+        int u = find_user(a);
+        rcourse_t* c = (idx >= 0 && idx < courseCnt) ? &courses[idx] : NULL;
+
+        if (strcmp(b, "LOGOUT") == 0) {
+            add_op(u, LOGOUT, 0, -1, OK);
+        } else if (strcmp(b, "CLIST") == 0) {
+            add_op(u, CLIST, 0, -1, CLIST);
+        } else if (strcmp(b, "SCHED") == 0) {
+            add_op(u, SCHED, 0, -1, SCHED);
+        } else if (strcmp(b, "NOSCHED") == 0) {
+            add_op(u, SCHED, 0, -1, ENOCOURSES);
+        } else if (strcmp(b, "ENROLL") == 0 && c) {
+            add_op(u, ENROLL, hasIdx, idx, OK);
+            roster_append(&c->enrolled, &c->enrolledCnt, u);
+        } else if (strcmp(b, "NOENROLL") == 0) {
+            add_op(u, ENROLL, hasIdx, idx, ECDENIED);
+        } else if (strcmp(b, "NOTFOUND_E") == 0) {
+            add_op(u, ENROLL, hasIdx, idx, ECNOTFOUND);
+        } else if (strcmp(b, "NOTOPEN_E") == 0 || strcmp(b, "CONFLICT_E") == 0 ||
+                   strcmp(b, "PREREQ_E") == 0 || strcmp(b, "COREQ_E") == 0) {
+            add_op(u, ENROLL, hasIdx, idx, ECDENIED);
+        } else if (strcmp(b, "NOTOPEN_W") == 0 || strcmp(b, "CONFLICT_W") == 0 ||
+                   strcmp(b, "PREREQ_W") == 0 || strcmp(b, "COREQ_W") == 0) {
+            add_op(u, WAIT, hasIdx, idx, ECDENIED);
+        } else if (strcmp(b, "WAIT") == 0 && c) {
+            add_op(u, WAIT, hasIdx, idx, OK);
+            roster_append(&c->waiting, &c->waitingCnt, u);
+        } else if (strcmp(b, "NOWAIT") == 0) {
+            add_op(u, WAIT, hasIdx, idx, ECDENIED);
+        } else if (strcmp(b, "NOTFOUND_W") == 0) {
+            add_op(u, WAIT, hasIdx, idx, ECNOTFOUND);
+        } else if (strcmp(b, "DROP") == 0 && c) {
+            add_op(u, DROP, hasIdx, idx, OK);
+            roster_remove(c->enrolled, &c->enrolledCnt, u);
+        } else if (strcmp(b, "NODROP") == 0) {
+            add_op(u, DROP, hasIdx, idx, ECDENIED);
+        } else if (strcmp(b, "NOTFOUND_D") == 0) {
+            add_op(u, DROP, hasIdx, idx, ECNOTFOUND);
+        } else if (strcmp(b, "SWAP") == 0 && c) {
+            // drop, enroll and the promotion it caused, all on one line
+            char tag[MAX_NAME], who[MAX_NAME];
+            int to = -1;
+            int m = sscanf(line, "%*s %*s %*d %d %*d %255s %255s", &to, tag, who);
+            add_op(u, SWAP, hasIdx, idx, OK);
+            ops[opCnt - 1].hasArg2 = m >= 1;
+            ops[opCnt - 1].arg2 = to;
+            roster_remove(c->enrolled, &c->enrolledCnt, u);
+            if (to >= 0 && to < courseCnt)
+                roster_append(&courses[to].enrolled, &courses[to].enrolledCnt, u);
+            if (m == 3) {
+                int p = find_user(who);
+                roster_remove(c->waiting, &c->waitingCnt, p);
+                if (strcmp(tag, "WAITADD") == 0)
+                    roster_append(&c->enrolled, &c->enrolledCnt, p);
+            }
+        } else if (strcmp(b, "NOSWAP") == 0 || strcmp(b, "NOTFOUND_S") == 0 ||
+                   strcmp(b, "NOTOPEN_S") == 0 || strcmp(b, "CONFLICT_S") == 0 ||
+                   strcmp(b, "PREREQ_S") == 0 || strcmp(b, "COREQ_S") == 0) {
+            int to = -1;
+            int m = sscanf(line, "%*s %*s %*d %d", &to);
+            add_op(u, SWAP, hasIdx, idx, strcmp(b, "NOTFOUND_S") == 0 ? ECNOTFOUND : ECDENIED);
+            ops[opCnt - 1].hasArg2 = m == 1;
+            ops[opCnt - 1].arg2 = to;
+        } else if (strcmp(b, "WAITPOS") == 0) {
+            add_op(u, WAITPOS, hasIdx, idx, WAITPOS);
+        } else if (strcmp(b, "NOWAITPOS") == 0) {
+            add_op(u, WAITPOS, hasIdx, idx, ECDENIED);
+        } else if (strcmp(b, "NOTFOUND_P") == 0) {
+            add_op(u, WAITPOS, hasIdx, idx, ECNOTFOUND);
+        } else if (strcmp(b, "CONTESTED") == 0) {
+            add_op(u, CONTESTED, hasIdx, idx, courseCnt > 0 ? CONTESTED : ENOCOURSES);
+        } else if (strcmp(b, "STATS") == 0) {
+            add_op(u, STATS, 0, -1, STATS);
+        } else if (strcmp(b, "RELOAD") == 0) {
+            // the server re-read its course file, which is the one given here
+            add_op(u, RELOAD, 0, -1, OK);
+            read_courses(courseFile);
+        } else if (strcmp(b, "NORELOAD") == 0) {
+            // failed reload, or a user not listed with -a
+            add_op(u, RELOAD, 0, -1, ECDENIED);
+        } else if (strcmp(b, "NOCONTESTED") == 0) {
+            add_op(u, CONTESTED, 0, -1, ECDENIED);
+        } else if (strcmp(b, "NOSTATS") == 0) {
+            add_op(u, STATS, 0, -1, ECDENIED);
+        } else if (strcmp(b, "OFFER") == 0 && c) {
+            // seat held for the head of the waitlist, claimed by a later ENROLL
+            roster_remove(c->waiting, &c->waitingCnt, u);
+        } else if (strcmp(b, "NOWAITADD") == 0 && c) {
+            // skipped over by a promotion because of a time conflict
+            roster_remove(c->waiting, &c->waitingCnt, u);
+        } else if (strcmp(b, "BUSY_E") == 0 || strcmp(b, "BUSY_W") == 0 || strcmp(b, "BUSY_D") == 0 ||
+                   strcmp(b, "BUSY_S") == 0) {
+            // shed under load without touching any course, a serial replay would not be
+        } else if (strcmp(b, "HOLDEXPIRE") == 0) {
+            // hold ran out on the server's timer, nothing to send
+        } else if (strcmp(b, "WAITADD") == 0 && c) {
+            // side effect of the preceding DROP, nothing to send
+            roster_remove(c->waiting, &c->waitingCnt, u);
+            roster_append(&c->enrolled, &c->enrolledCnt, u);
+        } else {
+            fprintf(stderr, "WARNING: %s:%d: skipping unrecognized line: %s", file_name, lineno, line);
+        }
+    }
+    fclose(f);
+}
+
+static int connect_server(const char* host, const char* port) {
+    struct addrinfo hints = {0}, *res;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0)
+        return -1;
+
+    int fd = socket(res->ai_family, res->ai_socktype, 0);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static int read_full(int fd, char* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, buf + got, len - got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        got += n;
+    }
+    return 0;
+}
+
+/*
+ * Send one request and wait for its reply.
+ * @return the reply message type, or -1 if the connection failed.
+ */
+static int send_op(const char* host, const char* port, op_t* op) {
+    ruser_t* u = &users[op->user];
+    char body[MAX_NAME];
+    petrV_header h = {0};
+
+    if (op->type == LOGIN) {
+        if (u->fd >= 0)
+            close(u->fd);
+        u->fd = connect_server(host, port);
+        if (u->fd < 0)
+            return -1;
+        snprintf(body, sizeof(body), "%s", u->name);
+    } else if (op->hasArg2) {
+        snprintf(body, sizeof(body), "%d,%d", op->arg, op->arg2);
+    } else if (op->hasArg) {
+        snprintf(body, sizeof(body), "%d", op->arg);
+    } else {
+        body[0] = '\0';
+    }
+    if (u->fd < 0)
+        return -1;
+
+    h.msg_type = op->type;
+    h.msg_len = strlen(body) + 1;
+    if (wr_msg(u->fd, &h, body) < 0)
+        return -1;
+
+    if (rd_msgheader(u->fd, &h) != 0)
+        return -1;
+    if (h.msg_len > 0) {
+        char* reply = malloc(h.msg_len);
+        int rc = read_full(u->fd, reply, h.msg_len);
+        free(reply);
+        if (rc != 0)
+            return -1;
+    }
+
+    if (op->type == LOGOUT) {
+        close(u->fd);
+        u->fd = -1;
+    }
+    return h.msg_type;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Format the line sigint_handler prints for course i into buf.
+ */
+static void expected_line(int i, char* buf, size_t len) {
+    rcourse_t* c = &courses[i];
+    int off = snprintf(buf, len, "%s, %d, %d, ", c->title, c->maxCap, c->enrolledCnt);
+    for (int j = 0; j < c->enrolledCnt && off < (int)len; ++j)
+        off += snprintf(buf + off, len - off, "%s%s", users[c->enrolled[j]].name, j + 1 < c->enrolledCnt ? ";" : "");
+    off += snprintf(buf + off, len - off, ", ");
+    for (int j = 0; j < c->waitingCnt && off < (int)len; ++j)
+        off += snprintf(buf + off, len - off, "%s%s", users[c->waiting[j]].name, j + 1 < c->waitingCnt ? ";" : "");
+}
+
+/*
+ * The server prints one line per course on SIGINT. Look for the expected
+ * block of lines anywhere in the captured output.
+ * @return 0 if the block is present, 1 otherwise.
+ */
+static int check_dump(const char* file_name) {
+    FILE* f = fopen(file_name, "r");
+    if (!f) {
+        fprintf(stderr, "ERROR: Could not open dump file\n");
+        exit(2);
+    }
+
+    static char expect[MAX_COURSES][8192];
+    char* seen[MAX_COURSES] = {0};
+    for (int i = 0; i < courseCnt; ++i)
+        expected_line(i, expect[i], sizeof(expect[i]));
+
+    char line[8192];
+    int matched = 0;
+    while (fgets(line, sizeof(line), f) && matched < courseCnt) {
+        line[strcspn(line, "\n")] = '\0';
+        if (strcmp(line, expect[matched]) == 0) {
+            matched++;
+            continue;
+        }
+        matched = strcmp(line, expect[0]) == 0 ? 1 : 0;
+        for (int i = 0; i < courseCnt; ++i) {
+            size_t tlen = strlen(courses[i].title);
+            if (strncmp(line, courses[i].title, tlen) == 0 && strncmp(line + tlen, ", ", 2) == 0) {
+                free(seen[i]);
+                seen[i] = strdup(line);
+            }
+        }
+    }
+    fclose(f);
+
+    if (matched == courseCnt) {
+        printf("Final state matches (%d courses).\n", courseCnt);
+        return 0;
+    }
+    for (int i = 0; i < courseCnt; ++i) {
+        if (seen[i] == NULL || strcmp(seen[i], expect[i]) != 0)
+            printf("MISMATCH course %d\n  expected: %s\n  actual:   %s\n", i, expect[i], seen[i] ? seen[i] : "(missing)");
+    }
+    return 1;
+}
+
+/*
+ * Issue the workload against the server and report throughput and latency.
+ * @return 0 if every reply matched the log, 1 otherwise.
+ */
+static int replay(const char* host, const char* port, double rate) {
+    printf("Replaying %d requests from %d users against %d courses.\n", opCnt, userCnt, courseCnt);
+
+    // Requests are issued one at a time, in log order, so the server sees the
+    // same interleaving it logged and ends up in the same state.
+    uint64_t* lat = malloc((opCnt ? opCnt : 1) * sizeof(uint64_t));
+    uint64_t interval = rate > 0 ? (uint64_t)(1e9 / rate) : 0;
+    int diverged = 0, failed = 0;
+    uint64_t start = now_ns();
+    for (int i = 0; i < opCnt; ++i) {
+        if (interval) {
+            uint64_t due = start + i * interval;
+            uint64_t t = now_ns();
+            if (due > t) {
+                struct timespec ts = { (due - t) / 1000000000ull, (due - t) % 1000000000ull };
+                nanosleep(&ts, NULL);
+            }
+        }
+        uint64_t t0 = now_ns();
+        int got = send_op(host, port, &ops[i]);
+        lat[i] = now_ns() - t0;
+
+        if (got < 0) {
+            failed++;
+        } else if (got != ops[i].expect) {
+            diverged++;
+            fprintf(stderr, "DIVERGED op %d: %s type %d arg %d: expected reply %d, got %d\n", i,
+                    users[ops[i].user].name, ops[i].type, ops[i].arg, ops[i].expect, got);
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    qsort(lat, opCnt, sizeof(uint64_t), cmp_u64);
+    double secs = elapsed / 1e9;
+    printf("%d requests in %.3f s (%.0f req/s), %d diverged, %d failed\n", opCnt, secs,
+           secs > 0 ? opCnt / secs : 0.0, diverged, failed);
+    if (opCnt > 0) {
+        printf("latency us: p50 %.1f, p99 %.1f, max %.1f\n", lat[opCnt / 2] / 1e3,
+               lat[(int)(opCnt * 0.99)] / 1e3, lat[opCnt - 1] / 1e3);
+    }
+    free(lat);
+
+    for (int i = 0; i < userCnt; ++i) {
+        if (users[i].fd >= 0)
+            close(users[i].fd);
+    }
+
+    return (diverged || failed) ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    double rate = 0;
+    int dry_run = 0;
+    pid_t server_pid = 0;
+    char* dump_filename = NULL;
+    while ((opt = getopt(argc, argv, "hnr:p:c:")) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_SUCCESS);
+            case 'n':
+                dry_run = 1;
+                break;
+            case 'r':
+                rate = atof(optarg);
+                break;
+            case 'p':
+                server_pid = atoi(optarg);
+                break;
+            case 'c':
+                dump_filename = optarg;
+                break;
+            default:
+                fprintf(stderr, USAGE_MSG);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (argc - optind != 4) {
+        fprintf(stderr, USAGE_MSG);
+        exit(EXIT_FAILURE);
+    }
+    char* host = argv[optind];
+    char* port = argv[optind + 1];
+
+    courseFile = argv[optind + 2];
+    read_courses(courseFile);
+    read_log(argv[optind + 3]);
+    int rc = dry_run ? 0 : replay(host, port, rate);
+
+    if (server_pid > 0) {
+        // the server prints its state from the SIGINT handler, give it time to finish
+        kill(server_pid, SIGINT);
+        for (int i = 0; i < 100 && kill(server_pid, 0) == 0; ++i)
+            usleep(50000);
+    }
+
+    if (dump_filename) {
+        rc |= check_dump(dump_filename);
+    } else {
+        char line[8192];
+        printf("Expected final state:\n");
+        for (int i = 0; i < courseCnt; ++i) {
+            expected_line(i, line, sizeof(line));
+            printf("%s\n", line);
+        }
+    }
+    return rc;
+}
+